@@ -0,0 +1,613 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lte-helper.h"
+#include "ns3/epc-helper.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lte-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/map-scheduler.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <ns3/log.h>
+#include "ue-context-tracker.h"
+#include "enb-spatial-index.h"
+#include "ue-mobility-state-tracker.h"
+#include "handover-preparation-scheduler.h"
+#include "sharded-epc-helper.h"
+#include "ue-activity-manager.h"
+
+using namespace ns3;
+
+/**
+ * Scale benchmark of the LTE+EPC handover stack.
+ *
+ * Runs one tier per invocation, from "tiny" (the 2 eNB / 5 UE size of
+ * the simulation scenario) up to "xlarge" (500 eNBs, 20000 UEs). eNBs are
+ * placed on a square grid, UEs uniformly over the covered area and a
+ * fraction of them moves at a random velocity. Each run appends one line
+ * to the results file, the parameters of the run followed by its figures:
+ *
+ *   tier,algorithm,enbs,ues,simTime,interSiteDistance,mobileFraction,
+ *   maxSpeed,interPacketInterval,adaptiveReporting,gatewayShards,
+ *   activeFraction,activityTimers,rngSeed,rngRun,setupWallSeconds,
+ *   runWallSeconds,events,eventsPerSecond,peakRssKb,handoversStarted,
+ *   handoversCompleted
+ *
+ * The EPC is a ShardedEpcHelper with --gatewayShards SGW/PGW nodes, each
+ * with its own remote host, covering contiguous blocks of cells.
+ * --activeFraction leaves part of the UEs without traffic, and
+ * --activityTimers lets a UeActivityManager move them to DRX and RRC
+ * inactive.
+ *
+ * With --baseline, the run is compared with the last line of the baseline
+ * file with the same parameters, and the program returns 1 if any figure
+ * is worse than the tolerance allows. The baseline is read before the run,
+ * so it may be the results file itself. Typical use:
+ *
+ *   for t in tiny small medium large xlarge; do
+ *     ./waf --run "benchmark-scenario --tier=$t --baseline=baseline.csv" || echo "$t regressed"
+ *   done
+ */
+
+NS_LOG_COMPONENT_DEFINE ("LteHandoverBenchmark");
+
+
+namespace ns3 {
+
+/// Map scheduler counting the events it hands to the simulator.
+class CountingMapScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CountingMapScheduler")
+      .SetParent<MapScheduler> ()
+      .AddConstructor<CountingMapScheduler> ()
+    ;
+    return tid;
+  }
+
+  virtual Scheduler::Event RemoveNext (void)
+  {
+    ++g_nEvents;
+    return MapScheduler::RemoveNext ();
+  }
+
+  static uint64_t g_nEvents;
+};
+
+uint64_t CountingMapScheduler::g_nEvents = 0;
+
+NS_OBJECT_ENSURE_REGISTERED (CountingMapScheduler);
+
+} // namespace ns3
+
+
+struct BenchmarkTier
+{
+  const char *name;
+  uint16_t nEnbs;
+  uint32_t nUes;
+  double simTime;
+};
+
+static const BenchmarkTier g_tiers[] = {
+  { "tiny",     2,     5, 2.1 },
+  { "small",    7,    70, 2.0 },
+  { "medium",  25,  1000, 1.0 },
+  { "large",  100,  4000, 1.0 },
+  { "xlarge", 500, 20000, 0.5 },
+};
+
+struct BenchmarkResult
+{
+  double setupWallSeconds;
+  double runWallSeconds;
+  uint64_t events;
+  double eventsPerSecond;
+  uint64_t peakRssKb;
+  uint64_t handoversStarted;
+  uint64_t handoversCompleted;
+};
+
+static uint64_t g_handoversStarted = 0;
+static uint64_t g_handoversCompleted = 0;
+
+void
+CountHandoverStart (uint64_t imsi, uint16_t cellid, uint16_t rnti, uint16_t targetCellId)
+{
+  ++g_handoversStarted;
+}
+
+void
+CountHandoverEndOk (uint64_t imsi, uint16_t cellid, uint16_t rnti)
+{
+  ++g_handoversCompleted;
+}
+
+static double
+GetWallSeconds ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static uint64_t
+GetPeakRssKb ()
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss; // KiB on Linux
+}
+
+static uint64_t
+ParseUint64 (const std::string &s)
+{
+  uint64_t value = 0;
+  std::istringstream (s) >> value;
+  return value;
+}
+
+static const char *g_resultsHeader =
+  "tier,algorithm,enbs,ues,simTime,interSiteDistance,mobileFraction,"
+  "maxSpeed,interPacketInterval,adaptiveReporting,gatewayShards,"
+  "activeFraction,activityTimers,rngSeed,rngRun,setupWallSeconds,"
+  "runWallSeconds,events,eventsPerSecond,peakRssKb,handoversStarted,"
+  "handoversCompleted";
+
+/// number of leading fields holding the parameters of the run
+static const uint32_t g_nConfigFields = 15;
+/// number of fields holding the figures of the run
+static const uint32_t g_nResultFields = 7;
+
+/**
+ * \param fileName
+ * \param config the parameters of the run, g_nConfigFields fields
+ * \param r
+ */
+static void
+WriteResult (const std::string &fileName, const std::string &config,
+             const BenchmarkResult &r)
+{
+  bool isNew;
+  {
+    std::ifstream in (fileName.c_str ());
+    isNew = !in.good () || in.peek () == std::ifstream::traits_type::eof ();
+  }
+  std::ofstream out (fileName.c_str (), std::ios_base::app);
+  NS_ABORT_MSG_UNLESS (out.good (), "cannot write " << fileName);
+  if (isNew)
+    {
+      out << g_resultsHeader << std::endl;
+    }
+  out << config << "," << r.setupWallSeconds << "," << r.runWallSeconds
+      << "," << r.events << "," << r.eventsPerSecond << "," << r.peakRssKb
+      << "," << r.handoversStarted << "," << r.handoversCompleted << std::endl;
+}
+
+/**
+ * \param fileName
+ * \param config the parameters the baseline must have been run with
+ * \param r the figures of the last matching line
+ * \return false if no line matches or the file cannot be read
+ */
+static bool
+ReadBaseline (const std::string &fileName, const std::string &config,
+              BenchmarkResult &r)
+{
+  std::ifstream in (fileName.c_str ());
+  bool found = false;
+  std::string line;
+  while (std::getline (in, line))
+    {
+      std::vector<std::string> fields;
+      std::stringstream ss (line);
+      std::string field;
+      while (std::getline (ss, field, ','))
+        {
+          fields.push_back (field);
+        }
+      // lines of older formats lack parameters and never match
+      if (fields.size () != g_nConfigFields + g_nResultFields)
+        {
+          continue;
+        }
+      std::string lineConfig = fields[0];
+      for (uint32_t i = 1; i < g_nConfigFields; ++i)
+        {
+          lineConfig += "," + fields[i];
+        }
+      if (lineConfig != config)
+        {
+          continue;
+        }
+      // keep the last matching line
+      const std::string *figures = &fields[g_nConfigFields];
+      r.setupWallSeconds = std::atof (figures[0].c_str ());
+      r.runWallSeconds = std::atof (figures[1].c_str ());
+      r.events = ParseUint64 (figures[2]);
+      r.eventsPerSecond = std::atof (figures[3].c_str ());
+      r.peakRssKb = ParseUint64 (figures[4]);
+      r.handoversStarted = ParseUint64 (figures[5]);
+      r.handoversCompleted = ParseUint64 (figures[6]);
+      found = true;
+    }
+  return found;
+}
+
+/// \return true if current is worse than baseline by more than tolerance
+static bool
+CheckFigure (const char *name, double baseline, double current,
+             bool higherIsBetter, double tolerance)
+{
+  double change = baseline > 0 ? (current - baseline) / baseline : 0.0;
+  bool regressed = higherIsBetter ? (change < -tolerance) : (change > tolerance);
+  std::cout << "  " << std::setw (18) << std::left << name
+            << std::setw (14) << baseline << " -> " << std::setw (14) << current
+            << std::showpos << std::fixed << std::setprecision (1) << change * 100 << "%"
+            << std::noshowpos << std::resetiosflags (std::ios_base::fixed) << std::setprecision (6)
+            << (regressed ? "  REGRESSION" : "") << std::endl;
+  return regressed;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string tierName = "tiny";
+  std::string handoverAlgorithm = "ns3::HybridSpatialHandoverPolicy";
+  std::string resultsFile = "benchmark-results.csv";
+  std::string baselineFile = "";
+  double tolerance = 0.10;
+  double interSiteDistance = 500.0;
+  double mobileFraction = 0.2;
+  double maxSpeed = 15.0;
+  double interPacketInterval = 100;
+  double simTime = 0;
+  bool adaptiveReporting = false;
+  uint32_t gatewayShards = 1;
+  double activeFraction = 1.0;
+  bool activityTimers = false;
+
+  CommandLine cmd;
+  cmd.AddValue("tier", "Scale tier: tiny, small, medium, large or xlarge", tierName);
+  cmd.AddValue("handoverAlgorithm", "TypeId of the handover algorithm", handoverAlgorithm);
+  cmd.AddValue("results", "CSV file the results are appended to", resultsFile);
+  cmd.AddValue("baseline", "CSV file of a previous run to compare with (empty for none)", baselineFile);
+  cmd.AddValue("tolerance", "Relative change of a figure flagged as a regression", tolerance);
+  cmd.AddValue("interSiteDistance", "Distance between neighbouring eNBs [m]", interSiteDistance);
+  cmd.AddValue("mobileFraction", "Fraction of UEs moving at a random velocity", mobileFraction);
+  cmd.AddValue("maxSpeed", "Maximum speed of the moving UEs [m/s]", maxSpeed);
+  cmd.AddValue("interPacketInterval", "Inter packet interval of the downlink flows [ms]", interPacketInterval);
+  cmd.AddValue("simTime", "Simulated time [s], zero for the tier default", simTime);
+  cmd.AddValue("adaptiveReporting", "Adapt report processing and TTT to the UE mobility state", adaptiveReporting);
+  cmd.AddValue("gatewayShards", "Number of SGW/PGW nodes, each with its own remote host", gatewayShards);
+  cmd.AddValue("activeFraction", "Fraction of UEs with a downlink flow, the others stay idle", activeFraction);
+  cmd.AddValue("activityTimers", "Move UEs without traffic to DRX and RRC inactive", activityTimers);
+  cmd.Parse(argc, argv);
+
+  const BenchmarkTier *tier = 0;
+  for (uint32_t i = 0; i < sizeof (g_tiers) / sizeof (g_tiers[0]); ++i)
+    {
+      if (tierName == g_tiers[i].name)
+        {
+          tier = &g_tiers[i];
+        }
+    }
+  NS_ABORT_MSG_UNLESS (tier != 0, "unknown tier " << tierName);
+  if (simTime <= 0)
+    {
+      simTime = tier->simTime;
+    }
+
+  // everything the figures depend on, written with the results and
+  // matched against the baseline
+  std::ostringstream configStream;
+  configStream << tier->name << "," << handoverAlgorithm << "," << tier->nEnbs << "," << tier->nUes
+               << "," << simTime << "," << interSiteDistance << "," << mobileFraction
+               << "," << maxSpeed << "," << interPacketInterval << "," << adaptiveReporting
+               << "," << gatewayShards << "," << activeFraction << "," << activityTimers
+               << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ();
+  std::string config = configStream.str ();
+
+  // read before the run, so that the baseline may be the results file
+  BenchmarkResult baseline;
+  bool haveBaseline = false;
+  if (!baselineFile.empty ())
+    {
+      haveBaseline = ReadBaseline (baselineFile, config, baseline);
+      if (!haveBaseline)
+        {
+          std::cout << "no baseline in " << baselineFile << " for " << config << std::endl;
+        }
+    }
+
+  double setupStart = GetWallSeconds ();
+
+  ObjectFactory schedulerFactory;
+  schedulerFactory.SetTypeId ("ns3::CountingMapScheduler");
+  Simulator::SetScheduler (schedulerFactory);
+
+  // the default SRS periodicity only fits 40 UEs per cell
+  Config::SetDefault ("ns3::LteEnbRrc::SrsPeriodicity", UintegerValue (320));
+
+  // contiguous blocks of grid rows per shard, so that few X2 neighbours
+  // fall into different shards
+  NS_ABORT_MSG_UNLESS (gatewayShards >= 1 && gatewayShards <= tier->nEnbs,
+                       "gatewayShards must be between 1 and the number of eNBs");
+  Config::SetDefault ("ns3::ShardedEpcHelper::NumShards", UintegerValue (gatewayShards));
+  Config::SetDefault ("ns3::ShardedEpcHelper::CellsPerShard",
+                      UintegerValue ((tier->nEnbs + gatewayShards - 1) / gatewayShards));
+
+  Ptr<LteHelper> lteHelper = CreateObject<LteHelper> ();
+  Ptr<ShardedEpcHelper> epcHelper = CreateObject<ShardedEpcHelper> ();
+  lteHelper->SetEpcHelper (epcHelper);
+  lteHelper->SetSchedulerType ("ns3::TtaFfMacScheduler");
+  lteHelper->SetHandoverAlgorithmType (handoverAlgorithm);
+
+  TypeId handoverTid = TypeId::LookupByName (handoverAlgorithm);
+  struct TypeId::AttributeInformation info;
+  if (handoverTid.LookupAttributeByName ("AdaptiveReporting", &info))
+    {
+      lteHelper->SetHandoverAlgorithmAttribute ("AdaptiveReporting",
+                                                BooleanValue (adaptiveReporting));
+      lteHelper->SetHandoverAlgorithmAttribute ("StatsInterval",
+                                                TimeValue (Seconds (0)));
+    }
+
+  // one remote host per PGW, each on its own /16
+  NodeContainer remoteHostContainer;
+  remoteHostContainer.Create (epcHelper->GetNShards ());
+  InternetStackHelper internet;
+  internet.Install (remoteHostContainer);
+
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
+  p2ph.SetDeviceAttribute ("Mtu", UintegerValue (1500));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (Seconds (0.010)));
+  Ipv4AddressHelper ipv4h;
+  ipv4h.SetBase ("1.0.0.0", "255.255.0.0");
+  Ipv4StaticRoutingHelper ipv4RoutingHelper;
+  for (uint32_t k = 0; k < epcHelper->GetNShards (); ++k)
+    {
+      Ptr<Node> remoteHost = remoteHostContainer.Get (k);
+      NetDeviceContainer internetDevices = p2ph.Install (epcHelper->GetPgwNode (k), remoteHost);
+      ipv4h.Assign (internetDevices);
+      ipv4h.NewNetwork ();
+
+      Ptr<Ipv4StaticRouting> remoteHostStaticRouting = ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
+      remoteHostStaticRouting->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
+    }
+
+  NodeContainer enbNodes;
+  NodeContainer ueNodes;
+  enbNodes.Create (tier->nEnbs);
+  ueNodes.Create (tier->nUes);
+
+  // eNBs on a square grid, UEs uniformly over the covered area
+  uint32_t gridWidth = std::ceil (std::sqrt ((double) tier->nEnbs));
+  uint32_t gridHeight = (tier->nEnbs + gridWidth - 1) / gridWidth;
+  double areaWidth = gridWidth * interSiteDistance;
+  double areaHeight = gridHeight * interSiteDistance;
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "MinX", DoubleValue (interSiteDistance / 2),
+                                 "MinY", DoubleValue (interSiteDistance / 2),
+                                 "DeltaX", DoubleValue (interSiteDistance),
+                                 "DeltaY", DoubleValue (interSiteDistance),
+                                 "GridWidth", UintegerValue (gridWidth),
+                                 "LayoutType", StringValue ("RowFirst"));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (enbNodes);
+
+  std::ostringstream xRange, yRange;
+  xRange << "ns3::UniformRandomVariable[Min=0|Max=" << areaWidth << "]";
+  yRange << "ns3::UniformRandomVariable[Min=0|Max=" << areaHeight << "]";
+  mobility.SetPositionAllocator ("ns3::RandomRectanglePositionAllocator",
+                                 "X", StringValue (xRange.str ()),
+                                 "Y", StringValue (yRange.str ()));
+  Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable> ();
+  uint32_t nMobile = tier->nUes * mobileFraction;
+  for (uint32_t u = 0; u < tier->nUes; ++u)
+    {
+      if (u < nMobile)
+        {
+          mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+          mobility.Install (ueNodes.Get (u));
+          double speed = uniform->GetValue (0, maxSpeed);
+          double direction = uniform->GetValue (0, 2 * M_PI);
+          ueNodes.Get (u)->GetObject<ConstantVelocityMobilityModel> ()
+            ->SetVelocity (Vector (speed * std::cos (direction), speed * std::sin (direction), 0));
+        }
+      else
+        {
+          mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+          mobility.Install (ueNodes.Get (u));
+        }
+    }
+
+  NetDeviceContainer enbLteDevs = lteHelper->InstallEnbDevice (enbNodes);
+  NetDeviceContainer ueLteDevs = lteHelper->InstallUeDevice (ueNodes);
+
+  Ptr<UeContextTracker> ueContexts = CreateObject<UeContextTracker> ();
+  Ptr<EnbSpatialIndex> spatialIndex = CreateObject<EnbSpatialIndex> ();
+  spatialIndex->SetUeContextTracker (ueContexts);
+  Ptr<UeMobilityStateTracker> mobilityStateTracker = CreateObject<UeMobilityStateTracker> ();
+  mobilityStateTracker->SetUeContextTracker (ueContexts);
+  Ptr<HandoverPreparationScheduler> preparationScheduler = CreateObject<HandoverPreparationScheduler> ();
+  preparationScheduler->SetUeContextTracker (ueContexts);
+  for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+    {
+      ueContexts->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+      spatialIndex->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+      mobilityStateTracker->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+      preparationScheduler->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+    }
+  for (uint32_t u = 0; u < ueLteDevs.GetN (); ++u)
+    {
+      spatialIndex->AddUe (ueLteDevs.Get (u)->GetObject<LteUeNetDevice> ());
+    }
+
+  internet.Install (ueNodes);
+  Ipv4InterfaceContainer ueIpIface = epcHelper->AssignUeIpv4Address (NetDeviceContainer (ueLteDevs));
+  for (uint32_t u = 0; u < ueNodes.GetN (); ++u)
+    {
+      Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting (ueNodes.Get (u)->GetObject<Ipv4> ());
+      ueStaticRouting->SetDefaultRoute (epcHelper->GetUeDefaultGatewayAddress (), 1);
+    }
+  // attach explicitly: the traffic of a UE goes through the remote host
+  // of the shard of its cell
+  std::vector<uint16_t> ueCellIds (ueLteDevs.GetN ());
+  for (uint32_t u = 0; u < ueLteDevs.GetN (); ++u)
+    {
+      Vector uePosition = ueNodes.Get (u)->GetObject<MobilityModel> ()->GetPosition ();
+      uint32_t closest = 0;
+      double closestDistance = std::numeric_limits<double>::max ();
+      for (uint32_t i = 0; i < enbNodes.GetN (); ++i)
+        {
+          double d = CalculateDistance (uePosition, enbNodes.Get (i)->GetObject<MobilityModel> ()->GetPosition ());
+          if (d < closestDistance)
+            {
+              closest = i;
+              closestDistance = d;
+            }
+        }
+      lteHelper->Attach (ueLteDevs.Get (u), enbLteDevs.Get (closest));
+      ueCellIds[u] = enbLteDevs.Get (closest)->GetObject<LteEnbNetDevice> ()->GetCellId ();
+    }
+
+  Ptr<UeActivityManager> activityManager;
+  if (activityTimers)
+    {
+      activityManager = CreateObject<UeActivityManager> ();
+      activityManager->SetUeContextTracker (ueContexts);
+      for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+        {
+          activityManager->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+        }
+      for (uint32_t u = 0; u < ueLteDevs.GetN (); ++u)
+        {
+          activityManager->AddUe (ueLteDevs.Get (u)->GetObject<LteUeNetDevice> ());
+        }
+    }
+
+  // X2 only between grid neighbours, a full mesh is quadratic in the eNBs
+  for (uint32_t i = 0; i < enbNodes.GetN (); ++i)
+    {
+      for (uint32_t j = i + 1; j < enbNodes.GetN (); ++j)
+        {
+          double d = CalculateDistance (enbNodes.Get (i)->GetObject<MobilityModel> ()->GetPosition (),
+                                        enbNodes.Get (j)->GetObject<MobilityModel> ()->GetPosition ());
+          if (d < 1.5 * interSiteDistance)
+            {
+              lteHelper->AddX2Interface (enbNodes.Get (i), enbNodes.Get (j));
+            }
+        }
+    }
+
+  uint16_t dlPort = 1234;
+  ApplicationContainer clientApps;
+  ApplicationContainer serverApps;
+  PacketSinkHelper dlPacketSinkHelper ("ns3::UdpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), dlPort));
+  serverApps.Add (dlPacketSinkHelper.Install (ueNodes));
+  uint32_t nActive = 0;
+  for (uint32_t u = 0; u < ueNodes.GetN (); ++u)
+    {
+      if (activeFraction < 1.0 && uniform->GetValue () >= activeFraction)
+        {
+          continue;
+        }
+      ++nActive;
+      UdpClientHelper dlClient (ueIpIface.GetAddress (u), dlPort);
+      dlClient.SetAttribute ("Interval", TimeValue (MilliSeconds (interPacketInterval)));
+      dlClient.SetAttribute ("MaxPackets", UintegerValue (1000000));
+      clientApps.Add (dlClient.Install (remoteHostContainer.Get (epcHelper->GetShard (ueCellIds[u]))));
+    }
+  serverApps.Start (Seconds (0.01));
+  clientApps.Start (Seconds (0.01));
+
+  Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/LteEnbRrc/HandoverStart",
+                                 MakeCallback (&CountHandoverStart));
+  Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/LteEnbRrc/HandoverEndOk",
+                                 MakeCallback (&CountHandoverEndOk));
+
+  double runStart = GetWallSeconds ();
+  Simulator::Stop (Seconds (simTime));
+  Simulator::Run ();
+  double runEnd = GetWallSeconds ();
+
+  BenchmarkResult result;
+  result.setupWallSeconds = runStart - setupStart;
+  result.runWallSeconds = runEnd - runStart;
+  result.events = CountingMapScheduler::g_nEvents;
+  result.eventsPerSecond = result.runWallSeconds > 0 ? result.events / result.runWallSeconds : 0;
+  result.peakRssKb = GetPeakRssKb ();
+  result.handoversStarted = g_handoversStarted;
+  result.handoversCompleted = g_handoversCompleted;
+  HandoverPreparationScheduler::Stats hoStats = preparationScheduler->GetStats ();
+  std::ostringstream activity;
+  activity << nActive << " UEs with traffic";
+  if (activityManager != 0)
+    {
+      activity << ", at the end " << activityManager->GetNUes (UeActivityManager::CONNECTED) << " connected, "
+               << activityManager->GetNUes (UeActivityManager::DRX) << " in DRX, "
+               << activityManager->GetNUes (UeActivityManager::INACTIVE) << " inactive";
+    }
+
+  Simulator::Destroy ();
+
+  std::cout << "tier " << tier->name << " (" << tier->nEnbs << " eNBs, " << tier->nUes << " UEs, "
+            << simTime << " s, " << gatewayShards << " gateway shards) with "
+            << handoverAlgorithm << std::endl
+            << "  setup " << result.setupWallSeconds << " s, run " << result.runWallSeconds << " s, "
+            << result.events << " events (" << result.eventsPerSecond << "/s), peak RSS "
+            << result.peakRssKb << " KiB, handovers " << result.handoversCompleted
+            << "/" << result.handoversStarted << std::endl
+            << "  preparations dispatched " << hoStats.dispatched << ", rejected " << hoStats.rejected
+            << ", timed out " << hoStats.timedOut << ", max queue delay "
+            << hoStats.maxQueueDelay.GetSeconds () * 1000 << " ms" << std::endl
+            << "  " << activity.str () << std::endl;
+  WriteResult (resultsFile, config, result);
+
+  if (!haveBaseline)
+    {
+      return 0;
+    }
+
+  std::cout << "comparison with " << baselineFile << " (tolerance " << tolerance * 100 << "%)" << std::endl;
+  bool regressed = false;
+  regressed |= CheckFigure ("runWallSeconds", baseline.runWallSeconds, result.runWallSeconds, false, tolerance);
+  regressed |= CheckFigure ("eventsPerSecond", baseline.eventsPerSecond, result.eventsPerSecond, true, tolerance);
+  regressed |= CheckFigure ("peakRssKb", baseline.peakRssKb, result.peakRssKb, false, tolerance);
+  // with the same seed, fewer completed handovers is a functional regression
+  regressed |= CheckFigure ("handoversCompleted", baseline.handoversCompleted, result.handoversCompleted, true, 0.0);
+  return regressed ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "enb-spatial-index.h"
+#include "policy-handover-algorithm.h"
+#include "ue-context-tracker.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <ns3/mobility-model.h>
+#include <ns3/lte-enb-net-device.h>
+#include <ns3/lte-ue-net-device.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EnbSpatialIndex");
+
+NS_OBJECT_ENSURE_REGISTERED (EnbSpatialIndex);
+
+
+EnbSpatialIndex::EnbSpatialIndex ()
+  : m_gridCellSize (250.0),
+    m_candidateRadius (1500.0),
+    m_maxCandidates (8),
+    m_nComputedCandidateSets (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+EnbSpatialIndex::~EnbSpatialIndex ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+EnbSpatialIndex::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::EnbSpatialIndex")
+    .SetParent<Object> ()
+    .SetGroupName("Lte")
+    .AddConstructor<EnbSpatialIndex> ()
+    .AddAttribute ("GridCellSize",
+                   "Side of the square grid buckets [m]",
+                   DoubleValue (250.0),
+                   MakeDoubleAccessor (&EnbSpatialIndex::m_gridCellSize),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("CandidateRadius",
+                   "Sites further than this distance from every point of "
+                   "the grid bucket of a UE are not candidate cells for "
+                   "that UE, so a candidate may be up to CandidateRadius "
+                   "plus the bucket diagonal away from the UE [m]",
+                   DoubleValue (1500.0),
+                   MakeDoubleAccessor (&EnbSpatialIndex::m_candidateRadius),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("MaxCandidates",
+                   "Maximum number of candidate cells per grid bucket, "
+                   "keeping the ones closest to the bucket centre rather "
+                   "than to the UE (0 means no limit)",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&EnbSpatialIndex::m_maxCandidates),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+
+void
+EnbSpatialIndex::SetUeContextTracker (Ptr<UeContextTracker> ueContexts)
+{
+  NS_LOG_FUNCTION (this << ueContexts);
+  m_ueContexts = ueContexts;
+}
+
+
+void
+EnbSpatialIndex::AddEnb (Ptr<LteEnbNetDevice> enbDevice)
+{
+  NS_LOG_FUNCTION (this << enbDevice);
+
+  Ptr<MobilityModel> mobility = enbDevice->GetNode ()->GetObject<MobilityModel> ();
+  NS_ASSERT_MSG (mobility != 0, "eNodeBs need a mobility model before being added to the index");
+  uint16_t cellId = enbDevice->GetCellId ();
+  AddEnb (cellId, mobility->GetPosition ());
+
+  Ptr<PolicyHandoverAlgorithmBase> policy = PolicyHandoverAlgorithmBase::GetPolicy (enbDevice);
+  if (policy != 0)
+    {
+      policy->BindEnb (enbDevice);
+      policy->SetCandidateIndex (this);
+    }
+}
+
+
+void
+EnbSpatialIndex::AddEnb (uint16_t cellId, Vector position)
+{
+  NS_LOG_FUNCTION (this << cellId << position);
+  NS_ASSERT_MSG (m_sitePositions.find (cellId) == m_sitePositions.end (),
+                 "cellId " << cellId << " already added");
+
+  m_sitePositions[cellId] = position;
+  m_sites[GetGridKey (position)].push_back (cellId);
+
+  // candidate sets near the new site are stale now
+  m_candidates.clear ();
+}
+
+
+void
+EnbSpatialIndex::AddUe (Ptr<LteUeNetDevice> ueDevice)
+{
+  NS_LOG_FUNCTION (this << ueDevice);
+  AddUe (ueDevice->GetImsi (), ueDevice->GetNode ()->GetObject<MobilityModel> ());
+}
+
+
+void
+EnbSpatialIndex::AddUe (uint64_t imsi, Ptr<MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << imsi << mobility);
+  NS_ASSERT_MSG (mobility != 0, "UEs need a mobility model before being added to the index");
+
+  m_ues[imsi] = mobility;
+}
+
+
+const std::vector<uint16_t>&
+EnbSpatialIndex::GetCandidateCells (uint64_t imsi)
+{
+  NS_LOG_FUNCTION (this << imsi);
+
+  std::map<uint64_t, Ptr<MobilityModel> >::const_iterator it = m_ues.find (imsi);
+  NS_ASSERT_MSG (it != m_ues.end (), "unknown IMSI " << imsi);
+
+  // constant-velocity UEs move without firing CourseChange, so the
+  // position is read on every query
+  return LookupCandidates (GetGridKey (it->second->GetPosition ()));
+}
+
+
+bool
+EnbSpatialIndex::IsCandidate (uint16_t servingCellId, uint16_t rnti, uint16_t targetCellId)
+{
+  NS_LOG_FUNCTION (this << servingCellId << rnti << targetCellId);
+
+  uint64_t imsi = m_ueContexts == 0 ? 0 : m_ueContexts->GetImsi (servingCellId, rnti);
+  if (imsi == 0 || m_ues.find (imsi) == m_ues.end ())
+    {
+      return true;
+    }
+
+  const std::vector<uint16_t> &candidates = GetCandidateCells (imsi);
+  return std::binary_search (candidates.begin (), candidates.end (), targetCellId);
+}
+
+
+uint32_t
+EnbSpatialIndex::GetNComputedCandidateSets () const
+{
+  return m_nComputedCandidateSets;
+}
+
+
+EnbSpatialIndex::GridKey_t
+EnbSpatialIndex::GetGridKey (const Vector &position) const
+{
+  return std::make_pair (static_cast<int32_t> (std::floor (position.x / m_gridCellSize)),
+                         static_cast<int32_t> (std::floor (position.y / m_gridCellSize)));
+}
+
+
+const std::vector<uint16_t>&
+EnbSpatialIndex::LookupCandidates (const GridKey_t &key)
+{
+  std::map<GridKey_t, std::vector<uint16_t> >::iterator it = m_candidates.find (key);
+  if (it == m_candidates.end ())
+    {
+      it = m_candidates.insert (std::make_pair (key, std::vector<uint16_t> ())).first;
+      ComputeCandidates (key, it->second);
+      ++m_nComputedCandidateSets;
+    }
+  return it->second;
+}
+
+
+void
+EnbSpatialIndex::ComputeCandidates (const GridKey_t &key, std::vector<uint16_t> &candidates) const
+{
+  NS_LOG_FUNCTION (this << key.first << key.second);
+
+  // a site is a candidate for the whole bucket if it is within range of
+  // any point of the bucket, i.e. of the centre plus half the diagonal
+  Vector centre ((key.first + 0.5) * m_gridCellSize,
+                 (key.second + 0.5) * m_gridCellSize,
+                 0.0);
+  double range = m_candidateRadius + m_gridCellSize * std::sqrt (0.5);
+  int32_t rings = static_cast<int32_t> (std::ceil (range / m_gridCellSize));
+
+  std::vector<std::pair<double, uint16_t> > inRange;
+  for (int32_t dx = -rings; dx <= rings; ++dx)
+    {
+      for (int32_t dy = -rings; dy <= rings; ++dy)
+        {
+          std::map<GridKey_t, std::vector<uint16_t> >::const_iterator bucket;
+          bucket = m_sites.find (std::make_pair (key.first + dx, key.second + dy));
+          if (bucket == m_sites.end ())
+            {
+              continue;
+            }
+          for (std::vector<uint16_t>::const_iterator cellIt = bucket->second.begin ();
+               cellIt != bucket->second.end (); ++cellIt)
+            {
+              const Vector &site = m_sitePositions.find (*cellIt)->second;
+              double dx2 = site.x - centre.x;
+              double dy2 = site.y - centre.y;
+              double distance = std::sqrt (dx2 * dx2 + dy2 * dy2);
+              if (distance <= range)
+                {
+                  inRange.push_back (std::make_pair (distance, *cellIt));
+                }
+            }
+        }
+    }
+
+  std::sort (inRange.begin (), inRange.end ());
+  if (m_maxCandidates > 0 && inRange.size () > m_maxCandidates)
+    {
+      inRange.resize (m_maxCandidates);
+    }
+
+  candidates.clear ();
+  candidates.reserve (inRange.size ());
+  for (std::vector<std::pair<double, uint16_t> >::const_iterator it = inRange.begin ();
+       it != inRange.end (); ++it)
+    {
+      candidates.push_back (it->second);
+    }
+  std::sort (candidates.begin (), candidates.end ());
+
+  NS_LOG_LOGIC ("bucket (" << key.first << "," << key.second << ") has "
+                << candidates.size () << " candidate cells");
+}
+
+
+} // namespace ns3
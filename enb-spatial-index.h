@@ -0,0 +1,144 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ENB_SPATIAL_INDEX_H
+#define ENB_SPATIAL_INDEX_H
+
+#include <ns3/object.h>
+#include <ns3/ptr.h>
+#include <ns3/vector.h>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+class MobilityModel;
+class LteEnbNetDevice;
+class LteUeNetDevice;
+class UeContextTracker;
+
+
+/**
+ * \brief Uniform grid over eNodeB sites giving each UE a bounded set of
+ *        candidate cells.
+ *
+ * The plane is divided into square buckets of GridCellSize metres. The
+ * candidate set of a bucket holds the sites within CandidateRadius of
+ * any point of the bucket, i.e. within CandidateRadius plus half the
+ * bucket diagonal of its centre, and keeps the MaxCandidates of them
+ * closest to the centre. It is computed on first use and shared by all
+ * UEs in that bucket, so it does not depend on where in the bucket the
+ * UE is: a candidate may be up to CandidateRadius plus the bucket
+ * diagonal away from the UE, and a UE near the edge of a bucket may have
+ * a closer site left out by MaxCandidates. A query reads the
+ * current position of the UE and looks up the set of its bucket, so its
+ * cost does not depend on the number of cells; only the first query in a
+ * bucket scans the sites around it.
+ *
+ * Handover algorithms see UEs by (cell ID, RNTI); the index maps them
+ * back to the IMSI with the UeContextTracker given to
+ * SetUeContextTracker().
+ */
+class EnbSpatialIndex : public Object
+{
+public:
+  EnbSpatialIndex ();
+  virtual ~EnbSpatialIndex ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  /**
+   * \param ueContexts the tracker mapping (cell ID, RNTI) to IMSI
+   */
+  void SetUeContextTracker (Ptr<UeContextTracker> ueContexts);
+
+  /**
+   * Add the site of an eNodeB and, if its handover algorithm is a
+   * PolicyHandoverAlgorithmBase, make it use this index.
+   * \param enbDevice
+   */
+  void AddEnb (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * Add an eNodeB site.
+   * \param cellId
+   * \param position
+   */
+  void AddEnb (uint16_t cellId, Vector position);
+
+  /**
+   * Track the position of a UE.
+   * \param ueDevice
+   */
+  void AddUe (Ptr<LteUeNetDevice> ueDevice);
+
+  /**
+   * Track the position of a UE.
+   * \param imsi
+   * \param mobility
+   */
+  void AddUe (uint64_t imsi, Ptr<MobilityModel> mobility);
+
+  /**
+   * \param imsi
+   * \return the candidate cells of the UE, sorted by cell ID
+   */
+  const std::vector<uint16_t>& GetCandidateCells (uint64_t imsi);
+
+  /**
+   * \param servingCellId
+   * \param rnti RNTI of the UE in the serving cell
+   * \param targetCellId
+   * \return false if the target cell is not a candidate for the UE; true
+   *         if it is, or if the UE is not known to the index
+   */
+  bool IsCandidate (uint16_t servingCellId, uint16_t rnti, uint16_t targetCellId);
+
+  /// \return the number of candidate sets computed so far
+  uint32_t GetNComputedCandidateSets () const;
+
+private:
+  /// Grid bucket coordinates.
+  typedef std::pair<int32_t, int32_t> GridKey_t;
+
+  GridKey_t GetGridKey (const Vector &position) const;
+  const std::vector<uint16_t>& LookupCandidates (const GridKey_t &key);
+  void ComputeCandidates (const GridKey_t &key, std::vector<uint16_t> &candidates) const;
+
+
+  double m_gridCellSize;
+  double m_candidateRadius;
+  uint32_t m_maxCandidates;
+
+  /// eNodeB positions, indexed by cell ID
+  std::map<uint16_t, Vector> m_sitePositions;
+  /// cell IDs of the sites located in each bucket
+  std::map<GridKey_t, std::vector<uint16_t> > m_sites;
+  /// candidate set of each bucket, dropped whenever a site is added
+  std::map<GridKey_t, std::vector<uint16_t> > m_candidates;
+  uint32_t m_nComputedCandidateSets;
+
+  /// mobility model of the UEs, indexed by IMSI
+  std::map<uint64_t, Ptr<MobilityModel> > m_ues;
+  Ptr<UeContextTracker> m_ueContexts;
+
+}; // end of class EnbSpatialIndex
+
+
+} // namespace ns3
+
+#endif /* ENB_SPATIAL_INDEX_H */
@@ -0,0 +1,453 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "handover-preparation-scheduler.h"
+#include "policy-handover-algorithm.h"
+#include "ue-context-tracker.h"
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/trace-source-accessor.h>
+#include <ns3/lte-enb-net-device.h>
+#include <ns3/lte-enb-rrc.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("HandoverPreparationScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (HandoverPreparationScheduler);
+
+
+HandoverPreparationScheduler::Stats::Stats ()
+  : submitted (0),
+    dispatched (0),
+    rejected (0),
+    acknowledged (0),
+    timedOut (0)
+{
+}
+
+
+HandoverPreparationScheduler::PairState::PairState ()
+  : inFlight (0)
+{
+}
+
+
+HandoverPreparationScheduler::HandoverPreparationScheduler ()
+  : m_maxConcurrentPreparations (4),
+    m_maxQueueLength (32)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+HandoverPreparationScheduler::~HandoverPreparationScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+HandoverPreparationScheduler::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::HandoverPreparationScheduler")
+    .SetParent<Object> ()
+    .SetGroupName("Lte")
+    .AddConstructor<HandoverPreparationScheduler> ()
+    .AddAttribute ("MaxConcurrentPreparations",
+                   "Maximum number of handovers in progress between a "
+                   "source and a target eNodeB",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&HandoverPreparationScheduler::m_maxConcurrentPreparations),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxQueueLength",
+                   "Maximum number of handovers waiting between a source "
+                   "and a target eNodeB; the least urgent one is rejected",
+                   UintegerValue (32),
+                   MakeUintegerAccessor (&HandoverPreparationScheduler::m_maxQueueLength),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MaxQueueDelay",
+                   "Queued handovers waiting longer than this are rejected",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&HandoverPreparationScheduler::m_maxQueueDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("BatchWindow",
+                   "Handovers towards the same target submitted within "
+                   "this window are dispatched together",
+                   TimeValue (MilliSeconds (5)),
+                   MakeTimeAccessor (&HandoverPreparationScheduler::m_batchWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("PreparationTimeout",
+                   "A slot is released if the target did not acknowledge "
+                   "the preparation within this time after dispatch",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&HandoverPreparationScheduler::m_preparationTimeout),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Dispatched",
+                     "A handover preparation left the queue",
+                     MakeTraceSourceAccessor (&HandoverPreparationScheduler::m_dispatchedTrace),
+                     "ns3::HandoverPreparationScheduler::DispatchedTracedCallback")
+    .AddTraceSource ("Rejected",
+                     "A handover preparation was rejected",
+                     MakeTraceSourceAccessor (&HandoverPreparationScheduler::m_rejectedTrace),
+                     "ns3::HandoverPreparationScheduler::RejectedTracedCallback")
+  ;
+  return tid;
+}
+
+
+void
+HandoverPreparationScheduler::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<CellPair_t, PairState>::iterator it = m_pairs.begin ();
+       it != m_pairs.end (); ++it)
+    {
+      it->second.batchEvent.Cancel ();
+    }
+  for (std::map<UeKey_t, Preparation>::iterator it = m_preparations.begin ();
+       it != m_preparations.end (); ++it)
+    {
+      it->second.timeout.Cancel ();
+    }
+  m_pairs.clear ();
+  m_preparations.clear ();
+  m_queuedTargets.clear ();
+  m_rrcs.clear ();
+}
+
+
+void
+HandoverPreparationScheduler::SetUeContextTracker (Ptr<UeContextTracker> ueContexts)
+{
+  NS_LOG_FUNCTION (this << ueContexts);
+  ueContexts->TraceConnectWithoutContext ("HandoverStart",
+                                          MakeCallback (&HandoverPreparationScheduler::NotifyHandoverStart, this));
+  ueContexts->TraceConnectWithoutContext ("ContextRemoved",
+                                          MakeCallback (&HandoverPreparationScheduler::NotifyContextRemoved, this));
+}
+
+
+void
+HandoverPreparationScheduler::AddEnb (Ptr<LteEnbNetDevice> enbDevice)
+{
+  NS_LOG_FUNCTION (this << enbDevice);
+
+  m_rrcs[enbDevice->GetCellId ()] = enbDevice->GetRrc ();
+
+  Ptr<PolicyHandoverAlgorithmBase> policy = PolicyHandoverAlgorithmBase::GetPolicy (enbDevice);
+  if (policy != 0)
+    {
+      policy->BindEnb (enbDevice);
+      policy->SetPreparationScheduler (this);
+    }
+}
+
+
+void
+HandoverPreparationScheduler::Submit (uint16_t sourceCellId, uint16_t rnti, uint16_t targetCellId,
+                                      uint8_t servingRsrq, Callback<void, uint16_t, uint16_t> trigger)
+{
+  NS_LOG_FUNCTION (this << sourceCellId << rnti << targetCellId << (uint16_t) servingRsrq);
+
+  UeKey_t ue (sourceCellId, rnti);
+  if (m_preparations.find (ue) != m_preparations.end ())
+    {
+      NS_LOG_LOGIC ("RNTI " << rnti << " of cellId " << sourceCellId << " already in handover");
+      return;
+    }
+  if (!IsReadyForHandover (ue))
+    {
+      NS_LOG_LOGIC ("RNTI " << rnti << " of cellId " << sourceCellId << " cannot hand over now");
+      Dequeue (ue);
+      return;
+    }
+
+  // only the latest target of a UE is kept
+  std::map<UeKey_t, uint16_t>::iterator queued = m_queuedTargets.find (ue);
+  if (queued != m_queuedTargets.end () && queued->second != targetCellId)
+    {
+      NS_LOG_LOGIC ("RNTI " << rnti << " of cellId " << sourceCellId << " now heads to cellId "
+                    << targetCellId << " instead of " << queued->second);
+      Dequeue (ue);
+    }
+
+  CellPair_t pair (sourceCellId, targetCellId);
+  PairState &state = m_pairs[pair];
+
+  Request request;
+  request.rnti = rnti;
+  request.servingRsrq = servingRsrq;
+  request.enqueued = Simulator::Now ();
+  request.trigger = trigger;
+
+  // a new report of a queued UE only refreshes its urgency
+  bool isNew = true;
+  for (std::list<Request>::iterator it = state.queue.begin (); it != state.queue.end (); ++it)
+    {
+      if (it->rnti == rnti)
+        {
+          request.enqueued = it->enqueued;
+          state.queue.erase (it);
+          isNew = false;
+          break;
+        }
+    }
+  if (isNew)
+    {
+      ++state.stats.submitted;
+    }
+
+  if (state.queue.size () >= m_maxQueueLength)
+    {
+      // the least urgent request is the last one
+      if (state.queue.back ().servingRsrq <= servingRsrq)
+        {
+          Reject (pair, rnti);
+          return;
+        }
+      Reject (pair, state.queue.back ().rnti);
+      state.queue.pop_back ();
+    }
+
+  std::list<Request>::iterator pos = state.queue.begin ();
+  while (pos != state.queue.end () && pos->servingRsrq <= servingRsrq)
+    {
+      ++pos;
+    }
+  state.queue.insert (pos, request);
+  m_queuedTargets[ue] = targetCellId;
+
+  if (!state.batchEvent.IsRunning ())
+    {
+      state.batchEvent = Simulator::Schedule (m_batchWindow,
+                                              &HandoverPreparationScheduler::Dispatch, this, pair);
+    }
+}
+
+
+HandoverPreparationScheduler::Stats
+HandoverPreparationScheduler::GetStats (uint16_t sourceCellId, uint16_t targetCellId) const
+{
+  std::map<CellPair_t, PairState>::const_iterator it;
+  it = m_pairs.find (CellPair_t (sourceCellId, targetCellId));
+  if (it == m_pairs.end ())
+    {
+      return Stats ();
+    }
+  return it->second.stats;
+}
+
+
+HandoverPreparationScheduler::Stats
+HandoverPreparationScheduler::GetStats () const
+{
+  Stats total;
+  for (std::map<CellPair_t, PairState>::const_iterator it = m_pairs.begin ();
+       it != m_pairs.end (); ++it)
+    {
+      const Stats &stats = it->second.stats;
+      total.submitted += stats.submitted;
+      total.dispatched += stats.dispatched;
+      total.rejected += stats.rejected;
+      total.acknowledged += stats.acknowledged;
+      total.timedOut += stats.timedOut;
+      total.totalQueueDelay = total.totalQueueDelay + stats.totalQueueDelay;
+      if (stats.maxQueueDelay > total.maxQueueDelay)
+        {
+          total.maxQueueDelay = stats.maxQueueDelay;
+        }
+    }
+  return total;
+}
+
+
+void
+HandoverPreparationScheduler::Dispatch (CellPair_t pair)
+{
+  NS_LOG_FUNCTION (this << pair.first << pair.second);
+
+  PairState &state = m_pairs[pair];
+  Time now = Simulator::Now ();
+
+  std::list<Request>::iterator it = state.queue.begin ();
+  while (it != state.queue.end ())
+    {
+      if (now - it->enqueued > m_maxQueueDelay)
+        {
+          Reject (pair, it->rnti);
+          it = state.queue.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+
+  while (state.inFlight < m_maxConcurrentPreparations && !state.queue.empty ())
+    {
+      Request request = state.queue.front ();
+      state.queue.pop_front ();
+      UeKey_t ue (pair.first, request.rnti);
+      m_queuedTargets.erase (ue);
+      if (m_preparations.find (ue) != m_preparations.end ())
+        {
+          NS_LOG_LOGIC ("RNTI " << request.rnti << " of cellId " << pair.first << " already in handover");
+          continue;
+        }
+      if (!IsReadyForHandover (ue))
+        {
+          Reject (pair, request.rnti);
+          continue;
+        }
+
+      Time queueDelay = now - request.enqueued;
+      ++state.inFlight;
+      ++state.stats.dispatched;
+      state.stats.totalQueueDelay = state.stats.totalQueueDelay + queueDelay;
+      if (queueDelay > state.stats.maxQueueDelay)
+        {
+          state.stats.maxQueueDelay = queueDelay;
+        }
+
+      Preparation preparation;
+      preparation.targetCellId = pair.second;
+      preparation.timeout = Simulator::Schedule (m_preparationTimeout,
+                                                 &HandoverPreparationScheduler::PreparationTimeout, this, ue);
+      m_preparations[ue] = preparation;
+
+      NS_LOG_LOGIC ("Dispatching handover of RNTI " << request.rnti << " from cellId " << pair.first
+                    << " to cellId " << pair.second << " after " << queueDelay.GetSeconds () << " s");
+      m_dispatchedTrace (pair.first, pair.second, request.rnti, queueDelay);
+      request.trigger (request.rnti, pair.second);
+    }
+}
+
+
+void
+HandoverPreparationScheduler::Reject (const CellPair_t &pair, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << pair.first << pair.second << rnti);
+  ++m_pairs[pair].stats.rejected;
+  m_queuedTargets.erase (UeKey_t (pair.first, rnti));
+  m_rejectedTrace (pair.first, pair.second, rnti);
+}
+
+
+void
+HandoverPreparationScheduler::Dequeue (const UeKey_t &ue)
+{
+  NS_LOG_FUNCTION (this << ue.first << ue.second);
+
+  std::map<UeKey_t, uint16_t>::iterator queued = m_queuedTargets.find (ue);
+  if (queued == m_queuedTargets.end ())
+    {
+      return;
+    }
+  std::list<Request> &queue = m_pairs[CellPair_t (ue.first, queued->second)].queue;
+  m_queuedTargets.erase (queued);
+  for (std::list<Request>::iterator it = queue.begin (); it != queue.end (); ++it)
+    {
+      if (it->rnti == ue.second)
+        {
+          queue.erase (it);
+          return;
+        }
+    }
+}
+
+
+void
+HandoverPreparationScheduler::Release (const UeKey_t &ue, bool acknowledged)
+{
+  NS_LOG_FUNCTION (this << ue.first << ue.second << acknowledged);
+
+  std::map<UeKey_t, Preparation>::iterator it = m_preparations.find (ue);
+  if (it == m_preparations.end ())
+    {
+      return;
+    }
+  CellPair_t pair (ue.first, it->second.targetCellId);
+  it->second.timeout.Cancel ();
+  m_preparations.erase (it);
+
+  PairState &state = m_pairs[pair];
+  NS_ASSERT (state.inFlight > 0);
+  --state.inFlight;
+  if (acknowledged)
+    {
+      ++state.stats.acknowledged;
+    }
+  else
+    {
+      ++state.stats.timedOut;
+    }
+
+  // called from RRC traces, so let the RRC finish before the next trigger
+  if (!state.queue.empty () && !state.batchEvent.IsRunning ())
+    {
+      state.batchEvent = Simulator::ScheduleNow (&HandoverPreparationScheduler::Dispatch, this, pair);
+    }
+}
+
+
+void
+HandoverPreparationScheduler::PreparationTimeout (UeKey_t ue)
+{
+  NS_LOG_FUNCTION (this << ue.first << ue.second);
+  NS_LOG_WARN ("Handover of RNTI " << ue.second << " from cellId " << ue.first << " timed out");
+  Release (ue, false);
+}
+
+
+bool
+HandoverPreparationScheduler::IsReadyForHandover (const UeKey_t &ue) const
+{
+  std::map<uint16_t, Ptr<LteEnbRrc> >::const_iterator it = m_rrcs.find (ue.first);
+  if (it == m_rrcs.end ())
+    {
+      return true;
+    }
+  // the RRC asserts on unknown RNTIs and ignores UEs in other states
+  return it->second->HasUeManager (ue.second)
+         && it->second->GetUeManager (ue.second)->GetState () == UeManager::CONNECTED_NORMALLY;
+}
+
+
+void
+HandoverPreparationScheduler::NotifyHandoverStart (uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti << targetCellId);
+  UeKey_t ue (cellId, rnti);
+  // the UE may also leave on a handover this scheduler did not dispatch
+  Dequeue (ue);
+  // fired on the HANDOVER REQUEST ACK, which ends the X2 preparation
+  Release (ue, true);
+}
+
+
+void
+HandoverPreparationScheduler::NotifyContextRemoved (uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti);
+  UeKey_t ue (cellId, rnti);
+  Dequeue (ue);
+  Release (ue, false);
+}
+
+
+} // namespace ns3
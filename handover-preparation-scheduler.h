@@ -0,0 +1,216 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef HANDOVER_PREPARATION_SCHEDULER_H
+#define HANDOVER_PREPARATION_SCHEDULER_H
+
+#include <ns3/object.h>
+#include <ns3/ptr.h>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/callback.h>
+#include <ns3/traced-callback.h>
+#include <list>
+#include <map>
+
+namespace ns3 {
+
+class LteEnbNetDevice;
+class UeContextTracker;
+class LteEnbRrc;
+
+
+/**
+ * \brief Admission control of X2 handover preparations per eNodeB pair.
+ *
+ * Handover algorithms submit their decisions here instead of triggering
+ * them directly. For each (source, target) pair at most
+ * MaxConcurrentPreparations handovers are in progress at a time; the
+ * others wait in a queue ordered by urgency, i.e. by the serving cell
+ * RSRQ of the UE (lowest first). Requests arriving within BatchWindow are
+ * released together, so a crowd moving to the same cell produces bursts
+ * of at most MaxConcurrentPreparations preparations instead of one X2
+ * message per UE as soon as its report arrives.
+ *
+ * A UE has at most one request queued or in progress across all pairs: a
+ * request towards another target replaces the queued one, and requests of
+ * a UE already in handover are ignored. Queued requests are dropped when
+ * the UE starts a handover or its context is removed, as reported by the
+ * UeContextTracker given to SetUeContextTracker().
+ *
+ * A request is rejected when the queue of its pair is full and it is the
+ * least urgent one, or when it waited longer than MaxQueueDelay; the UE
+ * will report again and be resubmitted. Requests the source eNodeB RRC
+ * would ignore, i.e. of UEs not in CONNECTED_NORMALLY state, are dropped
+ * on submission and on dispatch; targets without X2 interface are
+ * already left out by the policies, see
+ * PolicyHandoverAlgorithmBase::AddX2Neighbour().
+ *
+ * A slot is released when the target acknowledges the preparation
+ * (HandoverStart of the source eNodeB, fired on the X2 HANDOVER REQUEST
+ * ACK), when the UE context is removed, or after PreparationTimeout.
+ */
+class HandoverPreparationScheduler : public Object
+{
+public:
+  /// Statistics of one eNodeB pair, or of all pairs.
+  struct Stats
+  {
+    Stats ();
+
+    uint64_t submitted;
+    uint64_t dispatched;
+    uint64_t rejected;
+    uint64_t acknowledged; ///< preparations acknowledged by the target
+    uint64_t timedOut; ///< preparations released without acknowledgement
+    Time totalQueueDelay;
+    Time maxQueueDelay;
+  };
+
+  HandoverPreparationScheduler ();
+  virtual ~HandoverPreparationScheduler ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  /**
+   * Follow the handovers and the UE contexts seen by a tracker.
+   * \param ueContexts
+   */
+  void SetUeContextTracker (Ptr<UeContextTracker> ueContexts);
+
+  /**
+   * Check the state of the UEs of an eNodeB before dispatching and, if its
+   * handover algorithm is a PolicyHandoverAlgorithmBase, make it submit
+   * its handovers to this scheduler.
+   * \param enbDevice
+   */
+  void AddEnb (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * Queue a handover for preparation.
+   * \param sourceCellId
+   * \param rnti RNTI of the UE in the source cell
+   * \param targetCellId
+   * \param servingRsrq serving cell RSRQ of the UE, lower is more urgent
+   * \param trigger called with (rnti, targetCellId) when the preparation
+   *        may start
+   */
+  void Submit (uint16_t sourceCellId, uint16_t rnti, uint16_t targetCellId,
+               uint8_t servingRsrq, Callback<void, uint16_t, uint16_t> trigger);
+
+  /**
+   * \param sourceCellId
+   * \param targetCellId
+   * \return the statistics of the pair
+   */
+  Stats GetStats (uint16_t sourceCellId, uint16_t targetCellId) const;
+
+  /// \return the statistics summed over all pairs
+  Stats GetStats () const;
+
+  /**
+   * TracedCallback signature for dispatched preparations.
+   *
+   * \param [in] sourceCellId
+   * \param [in] targetCellId
+   * \param [in] rnti
+   * \param [in] queueDelay time spent in the queue
+   */
+  typedef void (* DispatchedTracedCallback)
+    (uint16_t sourceCellId, uint16_t targetCellId, uint16_t rnti, Time queueDelay);
+
+  /**
+   * TracedCallback signature for rejected preparations.
+   *
+   * \param [in] sourceCellId
+   * \param [in] targetCellId
+   * \param [in] rnti
+   */
+  typedef void (* RejectedTracedCallback)
+    (uint16_t sourceCellId, uint16_t targetCellId, uint16_t rnti);
+
+protected:
+  // inherited from Object
+  virtual void DoDispose ();
+
+private:
+  /// (source cell ID, target cell ID)
+  typedef std::pair<uint16_t, uint16_t> CellPair_t;
+  /// (source cell ID, RNTI)
+  typedef std::pair<uint16_t, uint16_t> UeKey_t;
+
+  /// A queued handover.
+  struct Request
+  {
+    uint16_t rnti;
+    uint8_t servingRsrq;
+    Time enqueued;
+    Callback<void, uint16_t, uint16_t> trigger;
+  };
+
+  /// A handover being prepared or executed.
+  struct Preparation
+  {
+    uint16_t targetCellId;
+    EventId timeout;
+  };
+
+  /// Queue, slots and statistics of one eNodeB pair.
+  struct PairState
+  {
+    PairState ();
+
+    std::list<Request> queue; ///< most urgent first
+    uint32_t inFlight;
+    EventId batchEvent;
+    Stats stats;
+  };
+
+  void Dispatch (CellPair_t pair);
+  void Reject (const CellPair_t &pair, uint16_t rnti);
+  /// Remove the queued request of a UE, if any.
+  void Dequeue (const UeKey_t &ue);
+  void Release (const UeKey_t &ue, bool acknowledged);
+  /// \return true if the source eNodeB RRC accepts a handover of the UE
+  bool IsReadyForHandover (const UeKey_t &ue) const;
+  void PreparationTimeout (UeKey_t ue);
+
+  void NotifyHandoverStart (uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId);
+  void NotifyContextRemoved (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+
+  uint32_t m_maxConcurrentPreparations;
+  uint32_t m_maxQueueLength;
+  Time m_maxQueueDelay;
+  Time m_batchWindow;
+  Time m_preparationTimeout;
+
+  std::map<CellPair_t, PairState> m_pairs;
+  std::map<UeKey_t, Preparation> m_preparations;
+  /// target cell ID of the queued requests
+  std::map<UeKey_t, uint16_t> m_queuedTargets;
+  /// RRC of the eNodeBs, indexed by cell ID
+  std::map<uint16_t, Ptr<LteEnbRrc> > m_rrcs;
+
+  TracedCallback<uint16_t, uint16_t, uint16_t, Time> m_dispatchedTrace;
+  TracedCallback<uint16_t, uint16_t, uint16_t> m_rejectedTrace;
+
+}; // end of class HandoverPreparationScheduler
+
+
+} // namespace ns3
+
+#endif /* HANDOVER_PREPARATION_SCHEDULER_H */
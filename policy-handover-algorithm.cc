@@ -0,0 +1,969 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "policy-handover-algorithm.h"
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/boolean.h>
+#include <ns3/pointer.h>
+#include <ns3/lte-common.h>
+#include <ns3/simulator.h>
+#include <ns3/trace-source-accessor.h>
+#include <ns3/lte-enb-net-device.h>
+#include <list>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PolicyHandoverAlgorithm");
+
+
+///////////////////////////////////////////
+// Shared state and attributes
+///////////////////////////////////////////
+
+
+PolicyHandoverAlgorithmBase::PolicyHandoverAlgorithmBase ()
+  : m_a2MeasId (0),
+    m_a3MeasId (0),
+    m_a4MeasId (0),
+    m_a5MeasId (0),
+    m_servingCellThreshold (30),
+    m_neighbourCellOffset (1),
+    m_cellId (0),
+    m_adaptiveReporting (false),
+    m_reportsReceived (0),
+    m_reportsProcessed (0),
+    m_handoverManagementSapUser (0),
+    m_handoverManagementSapProvider (0),
+    m_mediumTttScale (0.75),
+    m_highTttScale (0.5),
+    m_lastStatsReceived (0),
+    m_lastStatsProcessed (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+PolicyHandoverAlgorithmBase::~PolicyHandoverAlgorithmBase ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+PolicyHandoverAlgorithmBase::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::PolicyHandoverAlgorithmBase")
+    .SetParent<LteHandoverAlgorithm> ()
+    .SetGroupName("Lte")
+    .AddAttribute ("ServingCellThreshold",
+                   "If the RSRQ of the serving cell is worse than this "
+                   "threshold, neighbour cells are consider for handover "
+                   "(Event A2). Expressed in quantized range of [0..34] as "
+                   "per Section 9.1.7 of 3GPP TS 36.133.",
+                   UintegerValue (30),
+                   MakeUintegerAccessor (&PolicyHandoverAlgorithmBase::m_servingCellThreshold),
+                   MakeUintegerChecker<uint8_t> (0, 34))
+    .AddAttribute ("NeighbourCellOffset",
+                   "Minimum offset between the serving and the best neighbour "
+                   "cell to trigger the handover (Event A4). Expressed in "
+                   "quantized range of [0..34] as per Section 9.1.7 of "
+                   "3GPP TS 36.133.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&PolicyHandoverAlgorithmBase::m_neighbourCellOffset),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("Hysteresis",
+                   "Handover margin (hysteresis) in dB "
+                   "(rounded to the nearest multiple of 0.5 dB)",
+                   DoubleValue (3.0),
+                   MakeDoubleAccessor (&PolicyHandoverAlgorithmBase::m_hysteresisDb),
+                   MakeDoubleChecker<uint8_t> (0.0, 15.0)) // Hysteresis IE value range is [0..30] as per Section 6.3.5 of 3GPP TS 36.331
+    .AddAttribute ("TimeToTrigger",
+                   "Time during which neighbour cell's RSRP "
+                   "must continuously higher than serving cell's RSRP "
+                   "in order to trigger a handover",
+                   TimeValue (MilliSeconds (256)), // 3GPP time-to-trigger median value as per Section 6.3.5 of 3GPP TS 36.331
+                   MakeTimeAccessor (&PolicyHandoverAlgorithmBase::m_timeToTrigger),
+                   MakeTimeChecker ())
+    .AddAttribute ("A5ServingThreshold",
+                   "Event A5 threshold1: the serving cell must be worse than "
+                   "this value, in the quantized range of the scoring "
+                   "quantity (RSRP [0..97], RSRQ [0..34])",
+                   UintegerValue (34),
+                   MakeUintegerAccessor (&PolicyHandoverAlgorithmBase::m_a5Threshold1),
+                   MakeUintegerChecker<uint8_t> (0, 97))
+    .AddAttribute ("A5NeighbourThreshold",
+                   "Event A5 threshold2: the neighbour cell must be better "
+                   "than this value, in the quantized range of the scoring "
+                   "quantity (RSRP [0..97], RSRQ [0..34])",
+                   UintegerValue (40),
+                   MakeUintegerAccessor (&PolicyHandoverAlgorithmBase::m_a5Threshold2),
+                   MakeUintegerChecker<uint8_t> (0, 97))
+    .AddAttribute ("AdaptiveReporting",
+                   "Adapt report processing and time-to-trigger to the "
+                   "mobility state of each UE (needs a UeMobilityStateTracker, "
+                   "otherwise every UE is in normal mobility state)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PolicyHandoverAlgorithmBase::m_adaptiveReporting),
+                   MakeBooleanChecker ())
+    .AddAttribute ("NormalMobilityReportInterval",
+                   "Minimum time between two processed reports of the same "
+                   "measurement for a UE in normal mobility state",
+                   TimeValue (MilliSeconds (2048)),
+                   MakeTimeAccessor (&PolicyHandoverAlgorithmBase::m_normalReportInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("MediumMobilityReportInterval",
+                   "Minimum time between two processed reports of the same "
+                   "measurement for a UE in medium mobility state",
+                   TimeValue (MilliSeconds (1024)),
+                   MakeTimeAccessor (&PolicyHandoverAlgorithmBase::m_mediumReportInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("HighMobilityReportInterval",
+                   "Minimum time between two processed reports of the same "
+                   "measurement for a UE in high mobility state",
+                   TimeValue (MilliSeconds (0)),
+                   MakeTimeAccessor (&PolicyHandoverAlgorithmBase::m_highReportInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("MediumMobilityTttScale",
+                   "Time-to-trigger scaling factor in medium mobility state "
+                   "(sf-Medium of Section 6.3.5 of 3GPP TS 36.331)",
+                   DoubleValue (0.75),
+                   MakeDoubleAccessor (&PolicyHandoverAlgorithmBase::m_mediumTttScale),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("HighMobilityTttScale",
+                   "Time-to-trigger scaling factor in high mobility state "
+                   "(sf-High of Section 6.3.5 of 3GPP TS 36.331)",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&PolicyHandoverAlgorithmBase::m_highTttScale),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("StatsInterval",
+                   "Period of the ReportStats trace (zero to disable)",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&PolicyHandoverAlgorithmBase::m_statsInterval),
+                   MakeTimeChecker ())
+    .AddTraceSource ("ReportStats",
+                     "Measurement reports received and processed during "
+                     "the last StatsInterval",
+                     MakeTraceSourceAccessor (&PolicyHandoverAlgorithmBase::m_reportStatsTrace),
+                     "ns3::PolicyHandoverAlgorithmBase::ReportStatsTracedCallback")
+  ;
+  return tid;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::SetLteHandoverManagementSapUser (LteHandoverManagementSapUser* s)
+{
+  NS_LOG_FUNCTION (this << s);
+  m_handoverManagementSapUser = s;
+}
+
+
+LteHandoverManagementSapProvider*
+PolicyHandoverAlgorithmBase::GetLteHandoverManagementSapProvider ()
+{
+  NS_LOG_FUNCTION (this);
+  return m_handoverManagementSapProvider;
+}
+
+
+Ptr<PolicyHandoverAlgorithmBase>
+PolicyHandoverAlgorithmBase::GetPolicy (Ptr<LteEnbNetDevice> enbDevice)
+{
+  PointerValue handoverAlgorithm;
+  enbDevice->GetAttribute ("LteHandoverAlgorithm", handoverAlgorithm);
+  return handoverAlgorithm.Get<PolicyHandoverAlgorithmBase> ();
+}
+
+
+void
+PolicyHandoverAlgorithmBase::BindEnb (Ptr<LteEnbNetDevice> enbDevice)
+{
+  NS_LOG_FUNCTION (this << enbDevice);
+  uint16_t cellId = enbDevice->GetCellId ();
+  NS_ASSERT_MSG (m_cellId == 0 || m_cellId == cellId,
+                 "algorithm of cellId " << m_cellId << " bound to cellId " << cellId);
+  m_cellId = cellId;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::AddX2Neighbour (uint16_t cellId)
+{
+  NS_LOG_FUNCTION (this << cellId);
+  m_x2Neighbours.insert (cellId);
+}
+
+
+bool
+PolicyHandoverAlgorithmBase::IsX2Neighbour (uint16_t cellId) const
+{
+  return m_x2Neighbours.empty ()
+         || m_x2Neighbours.find (cellId) != m_x2Neighbours.end ();
+}
+
+
+void
+PolicyHandoverAlgorithmBase::SetCandidateIndex (Ptr<EnbSpatialIndex> index)
+{
+  NS_LOG_FUNCTION (this << index);
+  NS_ASSERT_MSG (m_cellId != 0, "BindEnb() not called");
+  m_candidateIndex = index;
+}
+
+
+bool
+PolicyHandoverAlgorithmBase::IsCandidateNeighbour (uint16_t rnti, uint16_t cellId) const
+{
+  return m_candidateIndex == 0
+         || m_candidateIndex->IsCandidate (m_cellId, rnti, cellId);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::SetMobilityStateTracker (Ptr<UeMobilityStateTracker> tracker)
+{
+  NS_LOG_FUNCTION (this << tracker);
+  NS_ASSERT_MSG (m_cellId != 0, "BindEnb() not called");
+  m_mobilityStateTracker = tracker;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::SetPreparationScheduler (Ptr<HandoverPreparationScheduler> scheduler)
+{
+  NS_LOG_FUNCTION (this << scheduler);
+  NS_ASSERT_MSG (m_cellId != 0, "BindEnb() not called");
+  m_preparationScheduler = scheduler;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::SetActivityManager (Ptr<UeActivityManager> manager)
+{
+  NS_LOG_FUNCTION (this << manager);
+  NS_ASSERT_MSG (m_cellId != 0, "BindEnb() not called");
+  m_activityManager = manager;
+}
+
+
+bool
+PolicyHandoverAlgorithmBase::IsReportingPaused (uint16_t rnti)
+{
+  return m_activityManager != 0
+         && m_activityManager->GetState (m_cellId, rnti) == UeActivityManager::INACTIVE
+         && GetMobilityState (rnti) == UeMobilityStateTracker::NORMAL;
+}
+
+
+uint64_t
+PolicyHandoverAlgorithmBase::GetReportsReceived () const
+{
+  return m_reportsReceived;
+}
+
+
+uint64_t
+PolicyHandoverAlgorithmBase::GetReportsProcessed () const
+{
+  return m_reportsProcessed;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::DoInitialize ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_statsInterval.IsStrictlyPositive ())
+    {
+      m_statsEvent = Simulator::Schedule (m_statsInterval,
+                                          &PolicyHandoverAlgorithmBase::ReportStats, this);
+    }
+  LteHandoverAlgorithm::DoInitialize ();
+}
+
+
+void
+PolicyHandoverAlgorithmBase::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_statsEvent.Cancel ();
+  for (std::map<uint16_t, TriggerHold>::iterator it = m_triggerHolds.begin ();
+       it != m_triggerHolds.end (); ++it)
+    {
+      it->second.expiry.Cancel ();
+    }
+  m_triggerHolds.clear ();
+  delete m_handoverManagementSapProvider;
+  m_handoverManagementSapProvider = 0;
+  m_candidateIndex = 0;
+  m_mobilityStateTracker = 0;
+  m_preparationScheduler = 0;
+  m_activityManager = 0;
+}
+
+
+bool
+PolicyHandoverAlgorithmBase::AcceptReport (uint16_t rnti, const LteRrcSap::MeasResults &measResults)
+{
+  if (m_mobilityStateTracker != 0)
+    {
+      m_mobilityStateTracker->NotifyServingRsrp (m_cellId, rnti, measResults.rsrpResult);
+    }
+
+  Time interval;
+  switch (GetMobilityState (rnti))
+    {
+    case UeMobilityStateTracker::HIGH:
+      interval = m_highReportInterval;
+      break;
+    case UeMobilityStateTracker::MEDIUM:
+      interval = m_mediumReportInterval;
+      break;
+    default:
+      interval = m_normalReportInterval;
+      break;
+    }
+
+  // the serving cell recovered: the A2 leave report must disarm the UE
+  if (measResults.measId == m_a2MeasId
+      && measResults.rsrqResult > m_servingCellThreshold)
+    {
+      return true;
+    }
+
+  // the hold of a slow UE must not wait for a report spaced out here
+  if (m_triggerHolds.find (rnti) != m_triggerHolds.end ()
+      && (measResults.measId == m_a3MeasId || measResults.measId == m_a5MeasId))
+    {
+      return true;
+    }
+
+  Time now = Simulator::Now ();
+  std::pair<uint16_t, uint8_t> key (rnti, measResults.measId);
+  std::map<std::pair<uint16_t, uint8_t>, Time>::iterator it = m_lastProcessed.find (key);
+  if (it != m_lastProcessed.end () && now < it->second + interval)
+    {
+      NS_LOG_LOGIC ("Skipping measId " << (uint16_t) measResults.measId
+                    << " of RNTI " << rnti << " (interval " << interval.GetSeconds () << " s)");
+      return false;
+    }
+  m_lastProcessed[key] = now;
+  return true;
+}
+
+
+bool
+PolicyHandoverAlgorithmBase::IsTriggerHoldElapsed (uint16_t rnti, uint16_t targetCellId, uint8_t servingRsrq)
+{
+  double scale = 1.0;
+  switch (GetMobilityState (rnti))
+    {
+    case UeMobilityStateTracker::HIGH:
+      scale = m_highTttScale;
+      break;
+    case UeMobilityStateTracker::MEDIUM:
+      scale = m_mediumTttScale;
+      break;
+    default:
+      break;
+    }
+
+  Time hold = Seconds (m_timeToTrigger.GetSeconds () * scale) - GetConfiguredTimeToTrigger ();
+  if (!hold.IsStrictlyPositive ())
+    {
+      CancelTriggerHold (rnti);
+      return true;
+    }
+
+  Time now = Simulator::Now ();
+  std::map<uint16_t, TriggerHold>::iterator it = m_triggerHolds.find (rnti);
+  if (it == m_triggerHolds.end () || it->second.targetCellId != targetCellId)
+    {
+      CancelTriggerHold (rnti);
+      TriggerHold &triggerHold = m_triggerHolds[rnti];
+      triggerHold.targetCellId = targetCellId;
+      triggerHold.since = now;
+      triggerHold.servingRsrq = servingRsrq;
+      triggerHold.expiry = Simulator::Schedule (hold, &PolicyHandoverAlgorithmBase::TriggerHoldExpired,
+                                                this, rnti);
+      NS_LOG_LOGIC ("Holding handover of RNTI " << rnti << " to cellId "
+                    << targetCellId << " for " << hold.GetSeconds () << " s");
+      return false;
+    }
+  if (now - it->second.since >= hold)
+    {
+      CancelTriggerHold (rnti);
+      return true;
+    }
+  it->second.servingRsrq = servingRsrq;
+  return false;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::UpdateTriggerHold (uint16_t rnti, uint16_t bestCellId,
+                                               const LteRrcSap::MeasResults &measResults)
+{
+  std::map<uint16_t, TriggerHold>::iterator it = m_triggerHolds.find (rnti);
+  if (it == m_triggerHolds.end ())
+    {
+      return;
+    }
+
+  if (bestCellId > 0 && measResults.haveMeasResultNeighCells)
+    {
+      for (std::list <LteRrcSap::MeasResultEutra>::const_iterator cellIt = measResults.measResultListEutra.begin ();
+           cellIt != measResults.measResultListEutra.end ();
+           ++cellIt)
+        {
+          if (cellIt->physCellId == it->second.targetCellId)
+            {
+              return;
+            }
+        }
+    }
+
+  NS_LOG_LOGIC ("cellId " << it->second.targetCellId << " no longer reported for RNTI "
+                          << rnti << ", hold dropped");
+  CancelTriggerHold (rnti);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::CancelTriggerHold (uint16_t rnti)
+{
+  std::map<uint16_t, TriggerHold>::iterator it = m_triggerHolds.find (rnti);
+  if (it != m_triggerHolds.end ())
+    {
+      it->second.expiry.Cancel ();
+      m_triggerHolds.erase (it);
+    }
+}
+
+
+void
+PolicyHandoverAlgorithmBase::TriggerHoldExpired (uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << rnti);
+
+  std::map<uint16_t, TriggerHold>::iterator it = m_triggerHolds.find (rnti);
+  NS_ASSERT (it != m_triggerHolds.end ());
+  uint16_t targetCellId = it->second.targetCellId;
+  uint8_t servingRsrq = it->second.servingRsrq;
+  m_triggerHolds.erase (it);
+
+  NS_LOG_LOGIC ("Hold of RNTI " << rnti << " to cellId " << targetCellId << " elapsed");
+  m_armedRntis.erase (rnti);
+  DoTriggerHandover (rnti, targetCellId, servingRsrq);
+}
+
+
+Time
+PolicyHandoverAlgorithmBase::GetConfiguredTimeToTrigger () const
+{
+  if (m_adaptiveReporting)
+    {
+      return Seconds (m_timeToTrigger.GetSeconds () * m_highTttScale);
+    }
+  return m_timeToTrigger;
+}
+
+
+UeMobilityStateTracker::State
+PolicyHandoverAlgorithmBase::GetMobilityState (uint16_t rnti)
+{
+  if (m_mobilityStateTracker == 0)
+    {
+      return UeMobilityStateTracker::NORMAL;
+    }
+  return m_mobilityStateTracker->GetState (m_cellId, rnti);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::NotifyUeContextRemoved (uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << rnti);
+  RemoveUeState (rnti);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::RemoveUeState (uint16_t rnti)
+{
+  m_armedRntis.erase (rnti);
+  m_neighbourCellMeasures.erase (rnti);
+  CancelTriggerHold (rnti);
+  m_lastProcessed.erase (m_lastProcessed.lower_bound (std::make_pair (rnti, (uint8_t) 0)),
+                         m_lastProcessed.upper_bound (std::make_pair (rnti, (uint8_t) 255)));
+}
+
+
+void
+PolicyHandoverAlgorithmBase::ReportStats ()
+{
+  uint32_t received = m_reportsReceived - m_lastStatsReceived;
+  uint32_t processed = m_reportsProcessed - m_lastStatsProcessed;
+  double processedPerSecond = processed / m_statsInterval.GetSeconds ();
+  NS_LOG_INFO (this << " reports received " << received
+                    << " processed " << processed
+                    << " (" << processedPerSecond << "/s)");
+  m_reportStatsTrace (received, processed, processedPerSecond);
+
+  m_lastStatsReceived = m_reportsReceived;
+  m_lastStatsProcessed = m_reportsProcessed;
+  m_statsEvent = Simulator::Schedule (m_statsInterval,
+                                      &PolicyHandoverAlgorithmBase::ReportStats, this);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::UpdateNeighbourMeasurements (uint16_t rnti,
+                                                          uint16_t cellId,
+                                                          uint8_t rsrq)
+{
+  NS_LOG_FUNCTION (this << rnti << cellId << (uint16_t) rsrq);
+  m_neighbourCellMeasures[rnti][cellId] = rsrq;
+}
+
+
+void
+PolicyHandoverAlgorithmBase::DoTriggerHandover (uint16_t rnti,
+                                                uint16_t targetCellId,
+                                                uint8_t servingRsrq)
+{
+  NS_LOG_FUNCTION (this << rnti << targetCellId << (uint16_t) servingRsrq);
+
+  if (m_preparationScheduler != 0)
+    {
+      NS_LOG_LOGIC ("Submit Handover to cellId " << targetCellId);
+      m_preparationScheduler->Submit (m_cellId, rnti, targetCellId, servingRsrq,
+                                      MakeCallback (&PolicyHandoverAlgorithmBase::TriggerHandoverNow, this));
+      return;
+    }
+  TriggerHandoverNow (rnti, targetCellId);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::TriggerHandoverNow (uint16_t rnti,
+                                                 uint16_t targetCellId)
+{
+  NS_LOG_FUNCTION (this << rnti << targetCellId);
+  NS_LOG_LOGIC ("Trigger Handover to cellId " << targetCellId);
+
+  RemoveUeState (rnti);
+
+  // Inform eNodeB RRC about handover
+  m_handoverManagementSapUser->TriggerHandover (rnti, targetCellId);
+}
+
+
+void
+PolicyHandoverAlgorithmBase::IgnoreReport (uint8_t measId) const
+{
+  NS_LOG_WARN ("Ignoring measId " << (uint16_t) measId);
+}
+
+
+///////////////////////////////////////////
+// Compile-time specialised report path
+///////////////////////////////////////////
+
+
+template <uint8_t Events, class Scorer, class Filter>
+PolicyHandoverAlgorithm<Events, Scorer, Filter>::PolicyHandoverAlgorithm ()
+{
+  NS_LOG_FUNCTION (this);
+  m_handoverManagementSapProvider = new MemberLteHandoverManagementSapProvider<PolicyHandoverAlgorithm> (this);
+}
+
+
+template <uint8_t Events, class Scorer, class Filter>
+void
+PolicyHandoverAlgorithm<Events, Scorer, Filter>::DoInitialize ()
+{
+  NS_LOG_FUNCTION (this);
+
+  uint8_t hysteresisIeValue = EutranMeasurementMapping::ActualHysteresis2IeValue (m_hysteresisDb);
+
+  if (Events & HandoverPolicy::EVENT_A2)
+    {
+      NS_LOG_LOGIC (this << " requesting Event A2 measurements"
+                         << " (threshold=" << (uint16_t) m_servingCellThreshold << ")");
+      LteRrcSap::ReportConfigEutra reportConfigA2;
+      reportConfigA2.eventId = LteRrcSap::ReportConfigEutra::EVENT_A2;
+      reportConfigA2.threshold1.choice = LteRrcSap::ThresholdEutra::THRESHOLD_RSRQ;
+      reportConfigA2.threshold1.range = m_servingCellThreshold;
+      reportConfigA2.triggerQuantity = LteRrcSap::ReportConfigEutra::RSRQ;
+      reportConfigA2.reportInterval = LteRrcSap::ReportConfigEutra::MS240;
+      // the hybrid policy must learn when the serving cell recovers
+      reportConfigA2.reportOnLeave = (Events & HandoverPolicy::EVENT_A3) != 0;
+      m_a2MeasId = m_handoverManagementSapUser->AddUeMeasReportConfigForHandover (reportConfigA2);
+    }
+
+  if (Events & HandoverPolicy::EVENT_A3)
+    {
+      NS_LOG_LOGIC (this << " requesting Event A3 measurements"
+                         << " (hysteresis=" << (uint16_t) hysteresisIeValue << ")"
+                         << " (ttt=" << GetConfiguredTimeToTrigger ().GetMilliSeconds () << ")");
+      LteRrcSap::ReportConfigEutra reportConfigA3;
+      reportConfigA3.eventId = LteRrcSap::ReportConfigEutra::EVENT_A3;
+      reportConfigA3.a3Offset = 0;
+      reportConfigA3.hysteresis = hysteresisIeValue;
+      reportConfigA3.timeToTrigger = GetConfiguredTimeToTrigger ().GetMilliSeconds ();
+      // with holds, the UE must report when the target stops being better
+      reportConfigA3.reportOnLeave = m_adaptiveReporting;
+      Scorer::Configure (reportConfigA3);
+      reportConfigA3.reportInterval = LteRrcSap::ReportConfigEutra::MS1024;
+      m_a3MeasId = m_handoverManagementSapUser->AddUeMeasReportConfigForHandover (reportConfigA3);
+    }
+
+  if (Events & HandoverPolicy::EVENT_A4)
+    {
+      NS_LOG_LOGIC (this << " requesting Event A4 measurements"
+                         << " (threshold=0)");
+      LteRrcSap::ReportConfigEutra reportConfigA4;
+      reportConfigA4.eventId = LteRrcSap::ReportConfigEutra::EVENT_A4;
+      reportConfigA4.threshold1.choice = LteRrcSap::ThresholdEutra::THRESHOLD_RSRQ;
+      reportConfigA4.threshold1.range = 0; // intentionally very low threshold
+      reportConfigA4.triggerQuantity = LteRrcSap::ReportConfigEutra::RSRQ;
+      reportConfigA4.reportInterval = LteRrcSap::ReportConfigEutra::MS480;
+      m_a4MeasId = m_handoverManagementSapUser->AddUeMeasReportConfigForHandover (reportConfigA4);
+    }
+
+  if (Events & HandoverPolicy::EVENT_A5)
+    {
+      NS_LOG_LOGIC (this << " requesting Event A5 measurements"
+                         << " (threshold1=" << (uint16_t) m_a5Threshold1 << ")"
+                         << " (threshold2=" << (uint16_t) m_a5Threshold2 << ")");
+      LteRrcSap::ReportConfigEutra reportConfigA5;
+      reportConfigA5.eventId = LteRrcSap::ReportConfigEutra::EVENT_A5;
+      Scorer::Configure (reportConfigA5);
+      reportConfigA5.threshold1.range = m_a5Threshold1;
+      reportConfigA5.threshold2.range = m_a5Threshold2;
+      reportConfigA5.hysteresis = hysteresisIeValue;
+      reportConfigA5.timeToTrigger = GetConfiguredTimeToTrigger ().GetMilliSeconds ();
+      reportConfigA5.reportOnLeave = m_adaptiveReporting;
+      reportConfigA5.reportInterval = LteRrcSap::ReportConfigEutra::MS480;
+      m_a5MeasId = m_handoverManagementSapUser->AddUeMeasReportConfigForHandover (reportConfigA5);
+    }
+
+  PolicyHandoverAlgorithmBase::DoInitialize ();
+}
+
+
+template <uint8_t Events, class Scorer, class Filter>
+void
+PolicyHandoverAlgorithm<Events, Scorer, Filter>::DoReportUeMeas (uint16_t rnti,
+                                                                 LteRrcSap::MeasResults measResults)
+{
+  NS_LOG_FUNCTION (this << rnti << (uint16_t) measResults.measId);
+
+  ++m_reportsReceived;
+  // A2 and A3/A5 of inactive UEs stand in for cell reselection
+  if ((Events & HandoverPolicy::EVENT_A4) && measResults.measId == m_a4MeasId
+      && IsReportingPaused (rnti))
+    {
+      NS_LOG_LOGIC ("RNTI " << rnti << " is inactive and parked, A4 report dropped");
+      return;
+    }
+  if (m_adaptiveReporting && !AcceptReport (rnti, measResults))
+    {
+      return;
+    }
+  ++m_reportsProcessed;
+
+  if ((Events & HandoverPolicy::EVENT_A4) && measResults.measId == m_a4MeasId)
+    {
+      if (measResults.haveMeasResultNeighCells
+          && !measResults.measResultListEutra.empty ())
+        {
+          for (std::list <LteRrcSap::MeasResultEutra>::iterator it = measResults.measResultListEutra.begin ();
+               it != measResults.measResultListEutra.end ();
+               ++it)
+            {
+              NS_ASSERT_MSG (it->haveRsrqResult == true,
+                             "RSRQ measurement is missing from cellId " << it->physCellId);
+              // keep the table bounded to the cells the UE can plausibly use
+              if (Filter::IsValid (this, rnti, it->physCellId))
+                {
+                  UpdateNeighbourMeasurements (rnti, it->physCellId, it->rsrqResult);
+                }
+            }
+        }
+      else
+        {
+          NS_LOG_WARN (this << " Event A4 received without measurement results from neighbouring cells");
+        }
+      return;
+    }
+
+  if ((Events & HandoverPolicy::EVENT_A2) && measResults.measId == m_a2MeasId)
+    {
+      if ((Events & HandoverPolicy::EVENT_A3)
+          && measResults.rsrqResult > m_servingCellThreshold)
+        {
+          NS_LOG_LOGIC ("Event A2 left for RNTI " << rnti);
+          m_armedRntis.erase (rnti);
+          CancelTriggerHold (rnti);
+          return;
+        }
+      NS_ASSERT_MSG (measResults.rsrqResult <= m_servingCellThreshold,
+                     "Invalid UE measurement report");
+      uint16_t targetCellId = (Events & HandoverPolicy::EVENT_A4)
+        ? EvaluateNeighbourTable (rnti, measResults.rsrqResult) : 0;
+
+      if (Events & HandoverPolicy::EVENT_A3)
+        {
+          // hybrid: leave the choice of the target to Event A3
+          if (targetCellId > 0)
+            {
+              m_armedRntis.insert (rnti);
+            }
+          else
+            {
+              m_armedRntis.erase (rnti);
+              CancelTriggerHold (rnti);
+            }
+        }
+      else if (targetCellId > 0)
+        {
+          DoTriggerHandover (rnti, targetCellId, measResults.rsrqResult);
+        }
+      return;
+    }
+
+  if ((Events & HandoverPolicy::EVENT_A3) && measResults.measId == m_a3MeasId)
+    {
+      if ((Events & HandoverPolicy::EVENT_A2)
+          && m_armedRntis.find (rnti) == m_armedRntis.end ())
+        {
+          NS_LOG_LOGIC ("Event A3 for RNTI " << rnti << " ignored until Event A2/A4 allow a handover");
+          return;
+        }
+
+      uint16_t targetCellId = SelectBestNeighbour (rnti, measResults);
+      if (m_adaptiveReporting)
+        {
+          UpdateTriggerHold (rnti, targetCellId, measResults);
+        }
+      if (targetCellId > 0
+          && (!m_adaptiveReporting || IsTriggerHoldElapsed (rnti, targetCellId, measResults.rsrqResult)))
+        {
+          if (Events & HandoverPolicy::EVENT_A2)
+            {
+              m_armedRntis.erase (rnti);
+            }
+          DoTriggerHandover (rnti, targetCellId, measResults.rsrqResult);
+        }
+      return;
+    }
+
+  if ((Events & HandoverPolicy::EVENT_A5) && measResults.measId == m_a5MeasId)
+    {
+      uint16_t targetCellId = SelectBestNeighbour (rnti, measResults);
+      if (m_adaptiveReporting)
+        {
+          UpdateTriggerHold (rnti, targetCellId, measResults);
+        }
+      if (targetCellId > 0
+          && (!m_adaptiveReporting || IsTriggerHoldElapsed (rnti, targetCellId, measResults.rsrqResult)))
+        {
+          DoTriggerHandover (rnti, targetCellId, measResults.rsrqResult);
+        }
+      return;
+    }
+
+  IgnoreReport (measResults.measId);
+
+} // end of DoReportUeMeas
+
+
+template <uint8_t Events, class Scorer, class Filter>
+uint16_t
+PolicyHandoverAlgorithm<Events, Scorer, Filter>::SelectBestNeighbour (uint16_t rnti,
+                                                                      const LteRrcSap::MeasResults &measResults) const
+{
+  uint16_t bestNeighbourCellId = 0;
+  uint8_t bestNeighbourScore = 0;
+
+  if (!measResults.haveMeasResultNeighCells)
+    {
+      return 0;
+    }
+
+  for (std::list <LteRrcSap::MeasResultEutra>::const_iterator it = measResults.measResultListEutra.begin ();
+       it != measResults.measResultListEutra.end ();
+       ++it)
+    {
+      uint8_t score;
+      if (Scorer::Score (*it, score)
+          && score > bestNeighbourScore
+          && Filter::IsValid (this, rnti, it->physCellId))
+        {
+          bestNeighbourCellId = it->physCellId;
+          bestNeighbourScore = score;
+        }
+    }
+
+  return bestNeighbourCellId;
+}
+
+
+template <uint8_t Events, class Scorer, class Filter>
+uint16_t
+PolicyHandoverAlgorithm<Events, Scorer, Filter>::EvaluateNeighbourTable (uint16_t rnti,
+                                                                         uint8_t servingCellRsrq) const
+{
+  MeasurementTable_t::const_iterator it1 = m_neighbourCellMeasures.find (rnti);
+
+  if (it1 == m_neighbourCellMeasures.end ())
+    {
+      NS_LOG_WARN ("Skipping handover evaluation for RNTI " << rnti << " because neighbour cells information is not found");
+      return 0;
+    }
+
+  uint16_t bestNeighbourCellId = 0;
+  uint8_t bestNeighbourRsrq = 0;
+  for (MeasurementRow_t::const_iterator it2 = it1->second.begin ();
+       it2 != it1->second.end (); ++it2)
+    {
+      if (it2->second > bestNeighbourRsrq
+          && Filter::IsValid (this, rnti, it2->first))
+        {
+          bestNeighbourCellId = it2->first;
+          bestNeighbourRsrq = it2->second;
+        }
+    }
+
+  if (bestNeighbourCellId > 0
+      && (bestNeighbourRsrq - servingCellRsrq) >= m_neighbourCellOffset)
+    {
+      return bestNeighbourCellId;
+    }
+  return 0;
+}
+
+
+///////////////////////////////////////////
+// Registered variants
+///////////////////////////////////////////
+
+
+template <>
+TypeId
+A3RsrpHandoverPolicy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::A3RsrpHandoverPolicy")
+    .SetParent<PolicyHandoverAlgorithmBase> ()
+    .SetGroupName("Lte")
+    .AddConstructor<A3RsrpHandoverPolicy> ()
+  ;
+  return tid;
+}
+
+
+template <>
+TypeId
+A2A4RsrqHandoverPolicy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::A2A4RsrqHandoverPolicy")
+    .SetParent<PolicyHandoverAlgorithmBase> ()
+    .SetGroupName("Lte")
+    .AddConstructor<A2A4RsrqHandoverPolicy> ()
+  ;
+  return tid;
+}
+
+
+template <>
+TypeId
+HybridHandoverPolicy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::HybridHandoverPolicy")
+    .SetParent<PolicyHandoverAlgorithmBase> ()
+    .SetGroupName("Lte")
+    .AddConstructor<HybridHandoverPolicy> ()
+  ;
+  return tid;
+}
+
+
+template <>
+TypeId
+A5RsrpHandoverPolicy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::A5RsrpHandoverPolicy")
+    .SetParent<PolicyHandoverAlgorithmBase> ()
+    .SetGroupName("Lte")
+    .AddConstructor<A5RsrpHandoverPolicy> ()
+  ;
+  return tid;
+}
+
+
+template <>
+TypeId
+A3RsrpSpatialHandoverPolicy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::A3RsrpSpatialHandoverPolicy")
+    .SetParent<PolicyHandoverAlgorithmBase> ()
+    .SetGroupName("Lte")
+    .AddConstructor<A3RsrpSpatialHandoverPolicy> ()
+  ;
+  return tid;
+}
+
+
+template <>
+TypeId
+HybridSpatialHandoverPolicy::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::HybridSpatialHandoverPolicy")
+    .SetParent<PolicyHandoverAlgorithmBase> ()
+    .SetGroupName("Lte")
+    .AddConstructor<HybridSpatialHandoverPolicy> ()
+  ;
+  return tid;
+}
+
+
+template class PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A3,
+                                       RsrpScorer, AnyNeighbourFilter>;
+template class PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A2 | HandoverPolicy::EVENT_A4,
+                                       RsrqScorer, AnyNeighbourFilter>;
+template class PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A2 | HandoverPolicy::EVENT_A3 | HandoverPolicy::EVENT_A4,
+                                       RsrpScorer, AnyNeighbourFilter>;
+template class PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A5,
+                                       RsrpScorer, AnyNeighbourFilter>;
+template class PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A3,
+                                       RsrpScorer, SpatialNeighbourFilter>;
+template class PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A2 | HandoverPolicy::EVENT_A3 | HandoverPolicy::EVENT_A4,
+                                       RsrpScorer, SpatialNeighbourFilter>;
+
+NS_OBJECT_ENSURE_REGISTERED (PolicyHandoverAlgorithmBase);
+NS_OBJECT_ENSURE_REGISTERED (A3RsrpHandoverPolicy);
+NS_OBJECT_ENSURE_REGISTERED (A2A4RsrqHandoverPolicy);
+NS_OBJECT_ENSURE_REGISTERED (HybridHandoverPolicy);
+NS_OBJECT_ENSURE_REGISTERED (A5RsrpHandoverPolicy);
+NS_OBJECT_ENSURE_REGISTERED (A3RsrpSpatialHandoverPolicy);
+NS_OBJECT_ENSURE_REGISTERED (HybridSpatialHandoverPolicy);
+
+
+} // end of namespace ns3
@@ -0,0 +1,496 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef POLICY_HANDOVER_ALGORITHM_H
+#define POLICY_HANDOVER_ALGORITHM_H
+
+#include <ns3/lte-handover-algorithm.h>
+#include <ns3/lte-handover-management-sap.h>
+#include <ns3/lte-rrc-sap.h>
+#include <ns3/nstime.h>
+#include <ns3/ptr.h>
+#include <ns3/event-id.h>
+#include <ns3/traced-callback.h>
+#include "enb-spatial-index.h"
+#include "ue-mobility-state-tracker.h"
+#include "handover-preparation-scheduler.h"
+#include "ue-activity-manager.h"
+#include <map>
+#include <set>
+
+namespace ns3 {
+
+class LteEnbNetDevice;
+
+
+/**
+ * \brief Measurement events a handover policy subscribes to.
+ *
+ * The values are bit flags; a policy variant is instantiated with the
+ * bitwise OR of the events it needs.
+ */
+namespace HandoverPolicy {
+enum Event
+{
+  EVENT_A2 = 0x01, ///< serving cell becomes worse than threshold
+  EVENT_A3 = 0x02, ///< neighbour becomes offset better than serving
+  EVENT_A4 = 0x04, ///< neighbour becomes better than threshold
+  EVENT_A5 = 0x08  ///< serving worse than threshold1, neighbour better than threshold2
+};
+} // namespace HandoverPolicy
+
+
+class PolicyHandoverAlgorithmBase;
+
+
+/**
+ * \brief Scores neighbour cells by their RSRP.
+ */
+struct RsrpScorer
+{
+  static void Configure (LteRrcSap::ReportConfigEutra &config)
+  {
+    config.triggerQuantity = LteRrcSap::ReportConfigEutra::RSRP;
+    config.threshold1.choice = LteRrcSap::ThresholdEutra::THRESHOLD_RSRP;
+    config.threshold2.choice = LteRrcSap::ThresholdEutra::THRESHOLD_RSRP;
+  }
+
+  static bool Score (const LteRrcSap::MeasResultEutra &result, uint8_t &score)
+  {
+    score = result.rsrpResult;
+    return result.haveRsrpResult;
+  }
+};
+
+
+/**
+ * \brief Scores neighbour cells by their RSRQ.
+ */
+struct RsrqScorer
+{
+  static void Configure (LteRrcSap::ReportConfigEutra &config)
+  {
+    config.triggerQuantity = LteRrcSap::ReportConfigEutra::RSRQ;
+    config.threshold1.choice = LteRrcSap::ThresholdEutra::THRESHOLD_RSRQ;
+    config.threshold2.choice = LteRrcSap::ThresholdEutra::THRESHOLD_RSRQ;
+  }
+
+  static bool Score (const LteRrcSap::MeasResultEutra &result, uint8_t &score)
+  {
+    score = result.rsrqResult;
+    return result.haveRsrqResult;
+  }
+};
+
+
+/**
+ * \brief State and attributes shared by all handover policy variants.
+ *
+ * Holds the SAP plumbing, the configuration attributes and the per-UE
+ * tables, so that the templated variants below only carry the report path.
+ */
+class PolicyHandoverAlgorithmBase : public LteHandoverAlgorithm
+{
+public:
+  PolicyHandoverAlgorithmBase ();
+  virtual ~PolicyHandoverAlgorithmBase ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  // inherited from LteHandoverAlgorithm
+  virtual void SetLteHandoverManagementSapUser (LteHandoverManagementSapUser* s);
+  virtual LteHandoverManagementSapProvider* GetLteHandoverManagementSapProvider ();
+
+  /**
+   * \param enbDevice
+   * \return the handover algorithm of the eNodeB if it is a policy, or 0
+   */
+  static Ptr<PolicyHandoverAlgorithmBase> GetPolicy (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * Record the cell ID of the eNodeB running this algorithm, under which
+   * the helpers set below know its UEs. Must be called before any of
+   * SetCandidateIndex(), SetMobilityStateTracker(),
+   * SetPreparationScheduler() and SetActivityManager().
+   * \param enbDevice the eNodeB whose handover algorithm this is
+   */
+  void BindEnb (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * Allow handovers to a cell with an X2 interface to this eNodeB. The
+   * eNodeB RRC ignores handovers to other cells, so once a neighbour is
+   * added only those added are valid targets; until then, every cell is.
+   * \param cellId
+   */
+  void AddX2Neighbour (uint16_t cellId);
+
+  /**
+   * \param cellId
+   * \return true if the cell was added with AddX2Neighbour(), or if none was
+   */
+  bool IsX2Neighbour (uint16_t cellId) const;
+
+  /**
+   * Restrict handover targets to the candidate cells given by a spatial
+   * index. Only used by variants with SpatialNeighbourFilter.
+   * \param index
+   */
+  void SetCandidateIndex (Ptr<EnbSpatialIndex> index);
+
+  /**
+   * \param rnti
+   * \param cellId
+   * \return true if no index is set or if the cell is a candidate for the UE
+   */
+  bool IsCandidateNeighbour (uint16_t rnti, uint16_t cellId) const;
+
+  /**
+   * Use the mobility state of the UEs to adapt report processing and
+   * time-to-trigger when AdaptiveReporting is enabled.
+   * \param tracker
+   */
+  void SetMobilityStateTracker (Ptr<UeMobilityStateTracker> tracker);
+
+  /**
+   * Submit the handovers to a preparation scheduler instead of triggering
+   * them directly.
+   * \param scheduler
+   */
+  void SetPreparationScheduler (Ptr<HandoverPreparationScheduler> scheduler);
+
+  /**
+   * Drop the A4 reports of the UEs the manager sees as RRC inactive and
+   * which are in normal mobility state. Their A2 and A3/A5 reports are
+   * still handled, since the UE stays RRC connected to this cell and they
+   * stand in for cell reselection.
+   * \param manager
+   */
+  void SetActivityManager (Ptr<UeActivityManager> manager);
+
+  /**
+   * Forget the per-UE state of an RNTI whose context left this cell, so
+   * that a UE later given the same RNTI starts afresh.
+   * \param rnti
+   */
+  void NotifyUeContextRemoved (uint16_t rnti);
+
+  /// \return the number of measurement reports received so far
+  uint64_t GetReportsReceived () const;
+
+  /// \return the number of measurement reports processed so far
+  uint64_t GetReportsProcessed () const;
+
+  /**
+   * TracedCallback signature for the periodic report statistics.
+   *
+   * \param [in] received reports received during the last StatsInterval
+   * \param [in] processed reports processed during the last StatsInterval
+   * \param [in] processedPerSecond processing rate over the last StatsInterval
+   */
+  typedef void (* ReportStatsTracedCallback)
+    (uint32_t received, uint32_t processed, double processedPerSecond);
+
+protected:
+  // inherited from Object
+  virtual void DoInitialize ();
+  virtual void DoDispose ();
+
+  /**
+   * Decide whether a report must be processed, given the mobility state
+   * of the UE. Reports of the same measId closer than the report interval
+   * of the state are skipped, except A2 reports of a recovered serving
+   * cell and A3/A5 reports while a trigger of the UE is on hold.
+   * \param rnti
+   * \param measResults
+   * \return true if the report must be processed
+   */
+  bool AcceptReport (uint16_t rnti, const LteRrcSap::MeasResults &measResults);
+
+  /**
+   * With AdaptiveReporting, the UE is configured with the time-to-trigger
+   * of the high mobility state; UEs in a slower state must additionally
+   * wait for the remaining time. The first report of a target starts a
+   * hold, which triggers the handover when it expires unless a report of
+   * another target replaced it, UpdateTriggerHold() or CancelTriggerHold()
+   * dropped it or the UE left the cell. A3 and A5 are then reported on
+   * leave, so that a target which stops being better drops the hold.
+   * \param rnti
+   * \param targetCellId
+   * \param servingRsrq serving cell RSRQ of the UE, used as urgency
+   * \return true if the handover to the target may be triggered now
+   */
+  bool IsTriggerHoldElapsed (uint16_t rnti, uint16_t targetCellId, uint8_t servingRsrq);
+
+  /**
+   * Drop the pending trigger hold of a UE if an A3/A5 report no longer
+   * lists its target, or has no valid target at all.
+   * \param rnti
+   * \param bestCellId best valid neighbour of the report, zero if none
+   * \param measResults
+   */
+  void UpdateTriggerHold (uint16_t rnti, uint16_t bestCellId,
+                          const LteRrcSap::MeasResults &measResults);
+
+  /**
+   * Drop the pending trigger hold of a UE, if any.
+   * \param rnti
+   */
+  void CancelTriggerHold (uint16_t rnti);
+
+  /**
+   * \param rnti
+   * \return true if the UE is RRC inactive and in normal mobility state,
+   *         so that its A4 reports must be dropped
+   */
+  bool IsReportingPaused (uint16_t rnti);
+
+  /// \return the time-to-trigger to configure in the UEs
+  Time GetConfiguredTimeToTrigger () const;
+
+  /**
+   * Store the RSRQ of a neighbour cell reported by Event A4.
+   * \param rnti
+   * \param cellId
+   * \param rsrq
+   */
+  void UpdateNeighbourMeasurements (uint16_t rnti, uint16_t cellId, uint8_t rsrq);
+
+  /**
+   * Ask the eNodeB RRC to hand the UE over to the given cell, through the
+   * preparation scheduler if one is set.
+   * \param rnti
+   * \param targetCellId
+   * \param servingRsrq serving cell RSRQ of the UE, used as urgency
+   */
+  void DoTriggerHandover (uint16_t rnti, uint16_t targetCellId, uint8_t servingRsrq);
+
+  /**
+   * Log a report whose measId does not belong to this policy.
+   * \param measId
+   */
+  void IgnoreReport (uint8_t measId) const;
+
+  /// Neighbour cell RSRQ reported by Event A4, indexed by cell ID.
+  typedef std::map<uint16_t, uint8_t> MeasurementRow_t;
+
+  /// Neighbour cell RSRQ rows, indexed by RNTI.
+  typedef std::map<uint16_t, MeasurementRow_t> MeasurementTable_t;
+
+  uint8_t m_a2MeasId;
+  uint8_t m_a3MeasId;
+  uint8_t m_a4MeasId;
+  uint8_t m_a5MeasId;
+
+  uint8_t m_servingCellThreshold;
+  uint8_t m_neighbourCellOffset;
+  double m_hysteresisDb;
+  Time m_timeToTrigger;
+  uint8_t m_a5Threshold1;
+  uint8_t m_a5Threshold2;
+
+  MeasurementTable_t m_neighbourCellMeasures;
+
+  /// UEs whose A2/A4 evaluation allows an A3 handover (hybrid policies).
+  std::set<uint16_t> m_armedRntis;
+
+  /// cell IDs of the X2 neighbours, empty if none were added
+  std::set<uint16_t> m_x2Neighbours;
+
+  Ptr<EnbSpatialIndex> m_candidateIndex;
+  uint16_t m_cellId;
+
+  bool m_adaptiveReporting;
+  uint64_t m_reportsReceived;
+  uint64_t m_reportsProcessed;
+
+  LteHandoverManagementSapUser* m_handoverManagementSapUser;
+  LteHandoverManagementSapProvider* m_handoverManagementSapProvider;
+
+private:
+  /// \return the mobility state of the UE, NORMAL without a tracker
+  UeMobilityStateTracker::State GetMobilityState (uint16_t rnti);
+
+  /**
+   * Hand the UE over now.
+   * \param rnti
+   * \param targetCellId
+   */
+  void TriggerHandoverNow (uint16_t rnti, uint16_t targetCellId);
+
+  /// Forget the per-UE state of a UE leaving the cell.
+  void RemoveUeState (uint16_t rnti);
+
+  /// Fire the ReportStats trace and schedule the next one.
+  void ReportStats ();
+
+  /**
+   * Trigger the handover held for a UE.
+   * \param rnti
+   */
+  void TriggerHoldExpired (uint16_t rnti);
+
+  /// Target of an A3/A5 trigger on hold.
+  struct TriggerHold
+  {
+    uint16_t targetCellId;
+    Time since;
+    uint8_t servingRsrq; ///< of the last report naming the target
+    EventId expiry;
+  };
+
+  Ptr<UeMobilityStateTracker> m_mobilityStateTracker;
+  Ptr<HandoverPreparationScheduler> m_preparationScheduler;
+  Ptr<UeActivityManager> m_activityManager;
+  Time m_normalReportInterval;
+  Time m_mediumReportInterval;
+  Time m_highReportInterval;
+  double m_mediumTttScale;
+  double m_highTttScale;
+
+  /// time of the last processed report, indexed by (RNTI, measId)
+  std::map<std::pair<uint16_t, uint8_t>, Time> m_lastProcessed;
+  /// pending trigger holds, indexed by RNTI
+  std::map<uint16_t, TriggerHold> m_triggerHolds;
+
+  Time m_statsInterval;
+  EventId m_statsEvent;
+  uint64_t m_lastStatsReceived;
+  uint64_t m_lastStatsProcessed;
+  TracedCallback<uint32_t, uint32_t, double> m_reportStatsTrace;
+
+}; // end of class PolicyHandoverAlgorithmBase
+
+
+/**
+ * \brief Accepts every reported X2 neighbour as a handover target.
+ */
+struct AnyNeighbourFilter
+{
+  static bool IsValid (const PolicyHandoverAlgorithmBase *owner,
+                       uint16_t rnti, uint16_t cellId)
+  {
+    return owner->IsX2Neighbour (cellId);
+  }
+};
+
+
+/**
+ * \brief Accepts only the X2 neighbours among the candidate cells of the
+ *        UE in the spatial index set with
+ *        PolicyHandoverAlgorithmBase::SetCandidateIndex().
+ */
+struct SpatialNeighbourFilter
+{
+  static bool IsValid (const PolicyHandoverAlgorithmBase *owner,
+                       uint16_t rnti, uint16_t cellId)
+  {
+    return owner->IsX2Neighbour (cellId)
+           && owner->IsCandidateNeighbour (rnti, cellId);
+  }
+};
+
+
+/**
+ * \brief Handover algorithm specialised at compile time.
+ *
+ * \tparam Events bitwise OR of HandoverPolicy::Event values
+ * \tparam Scorer scores a neighbour report (RsrpScorer, RsrqScorer)
+ * \tparam Filter decides whether a neighbour is a valid target
+ *
+ * Each combination is a distinct class with its own TypeId, so that the
+ * handover algorithm can be chosen by name, e.g.
+ *
+ *     lteHelper->SetHandoverAlgorithmType ("ns3::HybridHandoverPolicy");
+ *
+ * The event tests in DoReportUeMeas() are constant expressions, so each
+ * variant only keeps the branches for the events it subscribes to.
+ *
+ * If both Event A2 and Event A3 are selected, the policy behaves as the
+ * hybrid algorithm: A2/A4 decide whether a better neighbour exists, A3
+ * picks the target and triggers the handover. A2 is then reported on
+ * leave too, so that a UE whose serving cell recovers is disarmed.
+ */
+template <uint8_t Events, class Scorer, class Filter>
+class PolicyHandoverAlgorithm : public PolicyHandoverAlgorithmBase
+{
+public:
+  PolicyHandoverAlgorithm ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  /// let the forwarder class access the protected and private members
+  friend class MemberLteHandoverManagementSapProvider<PolicyHandoverAlgorithm>;
+
+protected:
+  // inherited from Object
+  virtual void DoInitialize ();
+
+  // inherited from LteHandoverAlgorithm as a Handover Management SAP implementation
+  virtual void DoReportUeMeas (uint16_t rnti, LteRrcSap::MeasResults measResults);
+
+private:
+  /**
+   * Find the best valid neighbour in a measurement report.
+   * \param rnti
+   * \param measResults
+   * \return the cell ID of the best neighbour, or zero if none
+   */
+  uint16_t SelectBestNeighbour (uint16_t rnti,
+                                const LteRrcSap::MeasResults &measResults) const;
+
+  /**
+   * Find the best valid neighbour stored by Event A4 which is at least
+   * NeighbourCellOffset better than the serving cell.
+   * \param rnti
+   * \param servingCellRsrq
+   * \return the cell ID of the neighbour, or zero if none
+   */
+  uint16_t EvaluateNeighbourTable (uint16_t rnti, uint8_t servingCellRsrq) const;
+
+}; // end of class PolicyHandoverAlgorithm
+
+
+typedef PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A3,
+                                RsrpScorer, AnyNeighbourFilter> A3RsrpHandoverPolicy;
+
+typedef PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A2 | HandoverPolicy::EVENT_A4,
+                                RsrqScorer, AnyNeighbourFilter> A2A4RsrqHandoverPolicy;
+
+typedef PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A2 | HandoverPolicy::EVENT_A3 | HandoverPolicy::EVENT_A4,
+                                RsrpScorer, AnyNeighbourFilter> HybridHandoverPolicy;
+
+typedef PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A5,
+                                RsrpScorer, AnyNeighbourFilter> A5RsrpHandoverPolicy;
+
+typedef PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A3,
+                                RsrpScorer, SpatialNeighbourFilter> A3RsrpSpatialHandoverPolicy;
+
+typedef PolicyHandoverAlgorithm<HandoverPolicy::EVENT_A2 | HandoverPolicy::EVENT_A3 | HandoverPolicy::EVENT_A4,
+                                RsrpScorer, SpatialNeighbourFilter> HybridSpatialHandoverPolicy;
+
+template <> TypeId A3RsrpHandoverPolicy::GetTypeId ();
+template <> TypeId A2A4RsrqHandoverPolicy::GetTypeId ();
+template <> TypeId HybridHandoverPolicy::GetTypeId ();
+template <> TypeId A5RsrpHandoverPolicy::GetTypeId ();
+template <> TypeId A3RsrpSpatialHandoverPolicy::GetTypeId ();
+template <> TypeId HybridSpatialHandoverPolicy::GetTypeId ();
+
+
+} // namespace ns3
+
+#endif /* POLICY_HANDOVER_ALGORITHM_H */
@@ -0,0 +1,448 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "sharded-epc-helper.h"
+#include "policy-handover-algorithm.h"
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <ns3/inet-socket-address.h>
+#include <ns3/mac48-address.h>
+#include <ns3/packet-socket-address.h>
+#include <ns3/point-to-point-helper.h>
+#include <ns3/internet-stack-helper.h>
+#include <ns3/ipv4.h>
+#include <ns3/ipv4-l3-protocol.h>
+#include <ns3/ipv6-l3-protocol.h>
+#include <ns3/virtual-net-device.h>
+#include <ns3/epc-enb-application.h>
+#include <ns3/epc-sgw-pgw-application.h>
+#include <ns3/epc-mme.h>
+#include <ns3/epc-x2.h>
+#include <ns3/epc-ue-nas.h>
+#include <ns3/lte-enb-net-device.h>
+#include <ns3/lte-enb-rrc.h>
+#include <ns3/lte-ue-net-device.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ShardedEpcHelper");
+
+NS_OBJECT_ENSURE_REGISTERED (ShardedEpcHelper);
+
+
+ShardedEpcHelper::ShardedEpcHelper ()
+  : m_nShards (1),
+    m_cellsPerShard (1),
+    m_gtpuUdpPort (2152)  // fixed by the standard
+{
+  NS_LOG_FUNCTION (this);
+
+  // since we use point-to-point links for all S1-U links,
+  // we use a /30 subnet which can hold exactly two addresses
+  // (remember that net broadcast and null address are not valid)
+  m_s1uIpv4AddressHelper.SetBase ("10.0.0.0", "255.255.255.252");
+  m_x2Ipv4AddressHelper.SetBase ("12.0.0.0", "255.255.255.252");
+
+  // we use a /8 net for all UEs; 7.0.0.1 is the TUN device of every PGW
+  m_ueAddressHelper.SetBase ("7.0.0.0", "255.0.0.0", "0.0.0.2");
+}
+
+
+ShardedEpcHelper::~ShardedEpcHelper ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+ShardedEpcHelper::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ShardedEpcHelper")
+    .SetParent<EpcHelper> ()
+    .SetGroupName("Lte")
+    .AddConstructor<ShardedEpcHelper> ()
+    .AddAttribute ("NumShards",
+                   "Number of SGW/PGW nodes",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&ShardedEpcHelper::m_nShards),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("CellsPerShard",
+                   "Number of consecutive cell IDs assigned to the same "
+                   "shard before moving to the next one",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&ShardedEpcHelper::m_cellsPerShard),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("S1uLinkDataRate",
+                   "The data rate to be used for the next S1-U link to be created",
+                   DataRateValue (DataRate ("10Gb/s")),
+                   MakeDataRateAccessor (&ShardedEpcHelper::m_s1uLinkDataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("S1uLinkDelay",
+                   "The delay to be used for the next S1-U link to be created",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&ShardedEpcHelper::m_s1uLinkDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("S1uLinkMtu",
+                   "The MTU of the next S1-U link to be created",
+                   UintegerValue (2000),
+                   MakeUintegerAccessor (&ShardedEpcHelper::m_s1uLinkMtu),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("X2LinkDataRate",
+                   "The data rate to be used for the next X2 link to be created",
+                   DataRateValue (DataRate ("10Gb/s")),
+                   MakeDataRateAccessor (&ShardedEpcHelper::m_x2LinkDataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("X2LinkDelay",
+                   "The delay to be used for the next X2 link to be created",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&ShardedEpcHelper::m_x2LinkDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("X2LinkMtu",
+                   "The MTU of the next X2 link to be created",
+                   UintegerValue (3000),
+                   MakeUintegerAccessor (&ShardedEpcHelper::m_x2LinkMtu),
+                   MakeUintegerChecker<uint16_t> ())
+  ;
+  return tid;
+}
+
+
+void
+ShardedEpcHelper::NotifyConstructionCompleted ()
+{
+  NS_LOG_FUNCTION (this);
+  EpcHelper::NotifyConstructionCompleted ();
+  for (uint32_t i = 0; i < m_nShards; ++i)
+    {
+      CreateShard ();
+    }
+}
+
+
+void
+ShardedEpcHelper::CreateShard ()
+{
+  NS_LOG_FUNCTION (this << m_shards.size ());
+
+  Shard shard;
+  shard.sgwPgw = CreateObject<Node> ();
+  InternetStackHelper internet;
+  internet.Install (shard.sgwPgw);
+
+  // create S1-U socket
+  Ptr<Socket> sgwPgwS1uSocket = Socket::CreateSocket (shard.sgwPgw, TypeId::LookupByName ("ns3::UdpSocketFactory"));
+  int retval = sgwPgwS1uSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), m_gtpuUdpPort));
+  NS_ASSERT (retval == 0);
+
+  // create TUN device implementing tunneling of user data over GTP-U/UDP/IP
+  shard.tunDevice = CreateObject<VirtualNetDevice> ();
+  // allow jumbo packets
+  shard.tunDevice->SetAttribute ("Mtu", UintegerValue (30000));
+  shard.tunDevice->SetAddress (Mac48Address::Allocate ());
+  shard.sgwPgw->AddDevice (shard.tunDevice);
+
+  // the TUN device is on the same subnet as the UEs, with the same address
+  // in every shard, so that the UE default gateway does not depend on it
+  Ptr<Ipv4> ipv4 = shard.sgwPgw->GetObject<Ipv4> ();
+  int32_t interface = ipv4->AddInterface (shard.tunDevice);
+  ipv4->AddAddress (interface, Ipv4InterfaceAddress (GetUeDefaultGatewayAddress (), Ipv4Mask ("255.0.0.0")));
+  ipv4->SetUp (interface);
+
+  // create EpcSgwPgwApplication
+  shard.sgwPgwApp = CreateObject<EpcSgwPgwApplication> (shard.tunDevice, sgwPgwS1uSocket);
+  shard.sgwPgw->AddApplication (shard.sgwPgwApp);
+
+  // connect SgwPgwApplication and virtual net device for tunneling
+  shard.tunDevice->SetSendCallback (MakeCallback (&EpcSgwPgwApplication::RecvFromTunDevice, shard.sgwPgwApp));
+
+  // Create MME and connect with SGW via S11 interface
+  shard.mme = CreateObject<EpcMme> ();
+  shard.mme->SetS11SapSgw (shard.sgwPgwApp->GetS11SapSgw ());
+  shard.sgwPgwApp->SetS11SapMme (shard.mme->GetS11SapMme ());
+
+  m_shards.push_back (shard);
+}
+
+
+void
+ShardedEpcHelper::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<Shard>::iterator it = m_shards.begin (); it != m_shards.end (); ++it)
+    {
+      it->tunDevice->SetSendCallback (MakeNullCallback<bool, Ptr<Packet>, const Address&, const Address&, uint16_t> ());
+      it->tunDevice = 0;
+      it->sgwPgwApp = 0;
+      it->mme = 0;
+      it->sgwPgw->Dispose ();
+    }
+  m_shards.clear ();
+  m_ues.clear ();
+  m_ueShards.clear ();
+  EpcHelper::DoDispose ();
+}
+
+
+void
+ShardedEpcHelper::AddEnb (Ptr<Node> enb, Ptr<NetDevice> lteEnbNetDevice, uint16_t cellId)
+{
+  NS_LOG_FUNCTION (this << enb << lteEnbNetDevice << cellId);
+  NS_ASSERT (enb == lteEnbNetDevice->GetNode ());
+
+  Shard &shard = m_shards[GetShard (cellId)];
+  NS_LOG_INFO ("cellId " << cellId << " served by shard " << GetShard (cellId));
+
+  // add an IPv4 stack to the previously created eNB
+  InternetStackHelper internet;
+  internet.Install (enb);
+
+  // create a point to point link between the new eNB and the SGW of its
+  // shard with the corresponding new NetDevices on each side
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (m_s1uLinkDataRate));
+  p2ph.SetDeviceAttribute ("Mtu", UintegerValue (m_s1uLinkMtu));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (m_s1uLinkDelay));
+  NetDeviceContainer enbSgwDevices = p2ph.Install (enb, shard.sgwPgw);
+
+  m_s1uIpv4AddressHelper.NewNetwork ();
+  Ipv4InterfaceContainer enbSgwIpIfaces = m_s1uIpv4AddressHelper.Assign (enbSgwDevices);
+  Ipv4Address enbAddress = enbSgwIpIfaces.GetAddress (0);
+  Ipv4Address sgwAddress = enbSgwIpIfaces.GetAddress (1);
+
+  // create S1-U socket for the ENB
+  Ptr<Socket> enbS1uSocket = Socket::CreateSocket (enb, TypeId::LookupByName ("ns3::UdpSocketFactory"));
+  int retval = enbS1uSocket->Bind (InetSocketAddress (enbAddress, m_gtpuUdpPort));
+  NS_ASSERT (retval == 0);
+
+  // create LTE socket for the ENB
+  Ptr<Socket> enbLteSocket = Socket::CreateSocket (enb, TypeId::LookupByName ("ns3::PacketSocketFactory"));
+  PacketSocketAddress enbLteSocketBindAddress;
+  enbLteSocketBindAddress.SetSingleDevice (lteEnbNetDevice->GetIfIndex ());
+  enbLteSocketBindAddress.SetProtocol (Ipv4L3Protocol::PROT_NUMBER);
+  retval = enbLteSocket->Bind (enbLteSocketBindAddress);
+  NS_ASSERT (retval == 0);
+  PacketSocketAddress enbLteSocketConnectAddress;
+  enbLteSocketConnectAddress.SetPhysicalAddress (Mac48Address::GetBroadcast ());
+  enbLteSocketConnectAddress.SetSingleDevice (lteEnbNetDevice->GetIfIndex ());
+  enbLteSocketConnectAddress.SetProtocol (Ipv4L3Protocol::PROT_NUMBER);
+  retval = enbLteSocket->Connect (enbLteSocketConnectAddress);
+  NS_ASSERT (retval == 0);
+
+  // create LTE socket for the ENB
+  Ptr<Socket> enbLteSocket6 = Socket::CreateSocket (enb, TypeId::LookupByName ("ns3::PacketSocketFactory"));
+  PacketSocketAddress enbLteSocketBindAddress6;
+  enbLteSocketBindAddress6.SetSingleDevice (lteEnbNetDevice->GetIfIndex ());
+  enbLteSocketBindAddress6.SetProtocol (Ipv6L3Protocol::PROT_NUMBER);
+  retval = enbLteSocket6->Bind (enbLteSocketBindAddress6);
+  NS_ASSERT (retval == 0);
+  PacketSocketAddress enbLteSocketConnectAddress6;
+  enbLteSocketConnectAddress6.SetPhysicalAddress (Mac48Address::GetBroadcast ());
+  enbLteSocketConnectAddress6.SetSingleDevice (lteEnbNetDevice->GetIfIndex ());
+  enbLteSocketConnectAddress6.SetProtocol (Ipv6L3Protocol::PROT_NUMBER);
+  retval = enbLteSocket6->Connect (enbLteSocketConnectAddress6);
+  NS_ASSERT (retval == 0);
+
+  NS_LOG_INFO ("create EpcEnbApplication");
+  Ptr<EpcEnbApplication> enbApp = CreateObject<EpcEnbApplication> (enbLteSocket, enbLteSocket6, enbS1uSocket, enbAddress, sgwAddress, cellId);
+  enb->AddApplication (enbApp);
+  NS_ASSERT (enb->GetNApplications () == 1);
+  NS_ASSERT_MSG (enb->GetApplication (0)->GetObject<EpcEnbApplication> () != 0, "cannot retrieve EpcEnbApplication");
+
+  NS_LOG_INFO ("Create EpcX2 entity");
+  Ptr<EpcX2> x2 = CreateObject<EpcX2> ();
+  enb->AggregateObject (x2);
+
+  NS_LOG_INFO ("connect S1-AP interface");
+  shard.mme->AddEnb (cellId, enbAddress, enbApp->GetS1apSapEnb ());
+  shard.sgwPgwApp->AddEnb (cellId, enbAddress, sgwAddress);
+  enbApp->SetS1apSapMme (shard.mme->GetS1apSapMme ());
+}
+
+
+void
+ShardedEpcHelper::AddX2Interface (Ptr<Node> enb1, Ptr<Node> enb2)
+{
+  NS_LOG_FUNCTION (this << enb1 << enb2);
+
+  Ptr<LteEnbNetDevice> enb1LteDev = enb1->GetDevice (0)->GetObject<LteEnbNetDevice> ();
+  uint16_t enb1CellId = enb1LteDev->GetCellId ();
+  Ptr<LteEnbNetDevice> enb2LteDev = enb2->GetDevice (0)->GetObject<LteEnbNetDevice> ();
+  uint16_t enb2CellId = enb2LteDev->GetCellId ();
+
+  if (GetShard (enb1CellId) != GetShard (enb2CellId))
+    {
+      NS_LOG_INFO ("no X2 interface between cellId " << enb1CellId << " and cellId " << enb2CellId
+                   << " of different shards");
+      return;
+    }
+
+  // Create a point to point link between the two eNBs with the
+  // corresponding new NetDevices on each side
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (m_x2LinkDataRate));
+  p2ph.SetDeviceAttribute ("Mtu", UintegerValue (m_x2LinkMtu));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (m_x2LinkDelay));
+  NetDeviceContainer enbDevices = p2ph.Install (enb1, enb2);
+
+  m_x2Ipv4AddressHelper.NewNetwork ();
+  Ipv4InterfaceContainer enbIpIfaces = m_x2Ipv4AddressHelper.Assign (enbDevices);
+  Ipv4Address enb1X2Address = enbIpIfaces.GetAddress (0);
+  Ipv4Address enb2X2Address = enbIpIfaces.GetAddress (1);
+
+  // Add X2 interface to both eNBs' X2 entities
+  Ptr<EpcX2> enb1X2 = enb1->GetObject<EpcX2> ();
+  Ptr<EpcX2> enb2X2 = enb2->GetObject<EpcX2> ();
+  enb1X2->AddX2Interface (enb1CellId, enb1X2Address, enb2CellId, enb2X2Address);
+  enb2X2->AddX2Interface (enb2CellId, enb2X2Address, enb1CellId, enb1X2Address);
+
+  enb1LteDev->GetRrc ()->AddX2Neighbour (enb2CellId);
+  enb2LteDev->GetRrc ()->AddX2Neighbour (enb1CellId);
+
+  Ptr<PolicyHandoverAlgorithmBase> enb1Policy = PolicyHandoverAlgorithmBase::GetPolicy (enb1LteDev);
+  if (enb1Policy != 0)
+    {
+      enb1Policy->AddX2Neighbour (enb2CellId);
+    }
+  Ptr<PolicyHandoverAlgorithmBase> enb2Policy = PolicyHandoverAlgorithmBase::GetPolicy (enb2LteDev);
+  if (enb2Policy != 0)
+    {
+      enb2Policy->AddX2Neighbour (enb1CellId);
+    }
+}
+
+
+void
+ShardedEpcHelper::AddUe (Ptr<NetDevice> ueDevice, uint64_t imsi)
+{
+  NS_LOG_FUNCTION (this << imsi << ueDevice);
+
+  // the serving eNodeB, hence the shard, is only known once the UE is
+  // attached, see ActivateEpsBearer ()
+  m_ues.insert (imsi);
+}
+
+
+uint8_t
+ShardedEpcHelper::ActivateEpsBearer (Ptr<NetDevice> ueDevice, uint64_t imsi, Ptr<EpcTft> tft, EpsBearer bearer)
+{
+  NS_LOG_FUNCTION (this << ueDevice << imsi);
+  NS_ASSERT_MSG (m_ues.find (imsi) != m_ues.end (), "unknown IMSI " << imsi);
+
+  // LteHelper::Attach (ue, enb) has made the UE camp on its eNodeB by now;
+  // X2 handovers stay within the shard, so the UE never leaves it
+  Ptr<LteUeNetDevice> ueLteDevice = ueDevice->GetObject<LteUeNetDevice> ();
+  NS_ASSERT_MSG (ueLteDevice != 0, "IMSI " << imsi << " is not an LTE UE");
+  uint16_t cellId = ueLteDevice->GetRrc ()->GetCellId ();
+  NS_ASSERT_MSG (cellId > 0, "IMSI " << imsi << " must be attached to an explicit eNodeB "
+                 "before its EPS bearers are activated");
+  uint32_t shardIndex = GetShard (cellId);
+  Shard &shard = m_shards[shardIndex];
+
+  std::map<uint64_t, uint32_t>::const_iterator it = m_ueShards.find (imsi);
+  if (it == m_ueShards.end ())
+    {
+      NS_LOG_INFO ("IMSI " << imsi << " served by shard " << shardIndex);
+      m_ueShards[imsi] = shardIndex;
+      shard.mme->AddUe (imsi);
+      shard.sgwPgwApp->AddUe (imsi);
+    }
+  else
+    {
+      NS_ASSERT_MSG (it->second == shardIndex,
+                     "IMSI " << imsi << " moved from shard " << it->second << " to shard " << shardIndex);
+    }
+
+  // we now retrieve the IPv4 address of the UE and notify it to the SGW;
+  // we couldn't do it before since address assignment is triggered by
+  // the user simulation program, rather than done by the EPC
+  Ptr<Node> ueNode = ueDevice->GetNode ();
+  Ptr<Ipv4> ueIpv4 = ueNode->GetObject<Ipv4> ();
+  NS_ASSERT_MSG (ueIpv4 != 0, "UEs need to have IPv4 installed before EPS bearers can be activated");
+  int32_t interface = ueIpv4->GetInterfaceForDevice (ueDevice);
+  NS_ASSERT (interface >= 0);
+  NS_ASSERT (ueIpv4->GetNAddresses (interface) == 1);
+  Ipv4Address ueAddr = ueIpv4->GetAddress (interface, 0).GetLocal ();
+  NS_LOG_LOGIC (" UE IP address: " << ueAddr);
+  shard.sgwPgwApp->SetUeAddress (imsi, ueAddr);
+
+  uint8_t bearerId = shard.mme->AddBearer (imsi, tft, bearer);
+  ueLteDevice->GetNas ()->ActivateEpsBearer (bearer, tft);
+  return bearerId;
+}
+
+
+Ptr<Node>
+ShardedEpcHelper::GetPgwNode ()
+{
+  return GetPgwNode (0);
+}
+
+
+Ptr<Node>
+ShardedEpcHelper::GetPgwNode (uint32_t shard)
+{
+  NS_ASSERT_MSG (shard < m_shards.size (), "no shard " << shard);
+  return m_shards[shard].sgwPgw;
+}
+
+
+Ipv4InterfaceContainer
+ShardedEpcHelper::AssignUeIpv4Address (NetDeviceContainer ueDevices)
+{
+  return m_ueAddressHelper.Assign (ueDevices);
+}
+
+
+Ipv4Address
+ShardedEpcHelper::GetUeDefaultGatewayAddress ()
+{
+  // return the address of the tun device
+  return Ipv4Address ("7.0.0.1");
+}
+
+
+Ipv6InterfaceContainer
+ShardedEpcHelper::AssignUeIpv6Address (NetDeviceContainer ueDevices)
+{
+  NS_FATAL_ERROR ("ShardedEpcHelper does not support IPv6 UEs");
+  return Ipv6InterfaceContainer ();
+}
+
+
+Ipv6Address
+ShardedEpcHelper::GetUeDefaultGatewayAddress6 ()
+{
+  NS_FATAL_ERROR ("ShardedEpcHelper does not support IPv6 UEs");
+  return Ipv6Address ();
+}
+
+
+uint32_t
+ShardedEpcHelper::GetNShards () const
+{
+  return m_shards.size ();
+}
+
+
+uint32_t
+ShardedEpcHelper::GetShard (uint16_t cellId) const
+{
+  NS_ASSERT (cellId > 0);
+  return ((cellId - 1) / m_cellsPerShard) % m_nShards;
+}
+
+
+} // namespace ns3
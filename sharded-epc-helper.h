@@ -0,0 +1,160 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SHARDED_EPC_HELPER_H
+#define SHARDED_EPC_HELPER_H
+
+#include <ns3/object.h>
+#include <ns3/ipv4-address-helper.h>
+#include <ns3/ipv6-address.h>
+#include <ns3/ipv6-interface-container.h>
+#include <ns3/data-rate.h>
+#include <ns3/epc-tft.h>
+#include <ns3/eps-bearer.h>
+#include <ns3/epc-helper.h>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace ns3 {
+
+class Node;
+class NetDevice;
+class VirtualNetDevice;
+class EpcSgwPgwApplication;
+class EpcMme;
+
+
+/**
+ * \brief EPC helper with several SGW/PGW nodes, each with its own MME.
+ *
+ * Works like PointToPointEpcHelper, but the user plane is split over
+ * NumShards SGW/PGW nodes ("shards") so that no single node carries the
+ * GTP-U traffic, tunnel tables and Internet link of every UE. The eNodeB
+ * application of this EPC talks to exactly one SGW and one MME, so the
+ * shard is chosen per eNodeB: cell IDs are grouped in blocks of
+ * CellsPerShard consecutive cells, assigned to the shards round-robin.
+ * A UE uses the shard of the eNodeB it is attached to.
+ *
+ * The UEs get their addresses from one 7.0.0.0/8 pool. Each UE is only
+ * registered in the SGW/PGW and MME of the shard of the cell it camps on
+ * when its first EPS bearer is activated, so UEs must be attached to an
+ * explicit eNodeB with LteHelper::Attach (ue, enb). X2 interfaces are only
+ * created between eNodeBs of the same shard, since the path switch of an
+ * X2 handover cannot move a UE to another SGW; choose CellsPerShard so
+ * that shards are contiguous areas. UEs at the edge of a shard therefore
+ * cannot hand over to the neighbouring shard: the cells of the X2
+ * interfaces set up here are registered with
+ * PolicyHandoverAlgorithmBase::AddX2Neighbour(), which keeps cells of
+ * other shards out of the neighbour tables and targets of the policies,
+ * including their spatial candidates. Other handover algorithms would
+ * have their triggers towards those cells ignored by the eNodeB RRC.
+ *
+ * Written against the EpcHelper API of ns-3.28: AddEnb() follows
+ * PointToPointEpcHelper::AddEnb() of that release, including the IPv6
+ * LTE socket of the eNodeB application. Other releases changed that API
+ * and are not supported. UEs only get IPv4 addresses; the IPv6 methods
+ * abort.
+ *
+ * Each PGW needs its own remote host (see GetPgwNode (uint32_t)); the
+ * traffic of a UE must use the remote host of the shard of its serving
+ * cell, see GetShard (). Attach UEs to an explicit eNodeB to know that
+ * cell: LteHelper does not record the eNodeB chosen by cell selection.
+ */
+class ShardedEpcHelper : public EpcHelper
+{
+public:
+  ShardedEpcHelper ();
+  virtual ~ShardedEpcHelper ();
+
+  // inherited from Object
+  static TypeId GetTypeId (void);
+  virtual void DoDispose ();
+
+  // inherited from EpcHelper
+  virtual void AddEnb (Ptr<Node> enbNode, Ptr<NetDevice> lteEnbNetDevice, uint16_t cellId);
+  virtual void AddUe (Ptr<NetDevice> ueLteDevice, uint64_t imsi);
+  virtual void AddX2Interface (Ptr<Node> enbNode1, Ptr<Node> enbNode2);
+  virtual uint8_t ActivateEpsBearer (Ptr<NetDevice> ueLteDevice, uint64_t imsi, Ptr<EpcTft> tft, EpsBearer bearer);
+  virtual Ptr<Node> GetPgwNode ();
+  virtual Ipv4InterfaceContainer AssignUeIpv4Address (NetDeviceContainer ueDevices);
+  virtual Ipv4Address GetUeDefaultGatewayAddress ();
+  virtual Ipv6InterfaceContainer AssignUeIpv6Address (NetDeviceContainer ueDevices);
+  virtual Ipv6Address GetUeDefaultGatewayAddress6 ();
+
+  /// \return the number of SGW/PGW shards
+  uint32_t GetNShards () const;
+
+  /**
+   * \param shard
+   * \return the SGW/PGW node of the shard
+   */
+  Ptr<Node> GetPgwNode (uint32_t shard);
+
+  /**
+   * \param cellId
+   * \return the shard serving the cell
+   */
+  uint32_t GetShard (uint16_t cellId) const;
+
+protected:
+  // inherited from ObjectBase, creates the shards once NumShards is known
+  virtual void NotifyConstructionCompleted ();
+
+private:
+  /// SGW/PGW node of a shard with its MME.
+  struct Shard
+  {
+    Ptr<Node> sgwPgw;
+    Ptr<VirtualNetDevice> tunDevice;
+    Ptr<EpcSgwPgwApplication> sgwPgwApp;
+    Ptr<EpcMme> mme;
+  };
+
+  void CreateShard ();
+
+  uint32_t m_nShards;
+  uint32_t m_cellsPerShard;
+  std::vector<Shard> m_shards;
+
+  /// IMSIs of the UEs added with AddUe ()
+  std::set<uint64_t> m_ues;
+  /// shard of the UEs with an EPS bearer, indexed by IMSI
+  std::map<uint64_t, uint32_t> m_ueShards;
+
+  /// helper to assign addresses to UE devices, shared by all shards
+  Ipv4AddressHelper m_ueAddressHelper;
+  /// helper to assign addresses to S1-U NetDevices
+  Ipv4AddressHelper m_s1uIpv4AddressHelper;
+  /// helper to assign addresses to X2 NetDevices
+  Ipv4AddressHelper m_x2Ipv4AddressHelper;
+
+  DataRate m_s1uLinkDataRate;
+  Time m_s1uLinkDelay;
+  uint16_t m_s1uLinkMtu;
+  DataRate m_x2LinkDataRate;
+  Time m_x2LinkDelay;
+  uint16_t m_x2LinkMtu;
+
+  /// UDP port where the GTP-U Socket is bound, fixed by the standard as 2152
+  uint16_t m_gtpuUdpPort;
+
+}; // end of class ShardedEpcHelper
+
+
+} // namespace ns3
+
+#endif /* SHARDED_EPC_HELPER_H */
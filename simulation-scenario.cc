@@ -40,6 +40,11 @@
 #include "ns3/propagation-loss-model.h"
 
 #include <ns3/log.h>
+#include "ue-context-tracker.h"
+#include "enb-spatial-index.h"
+#include "ue-mobility-state-tracker.h"
+#include "handover-preparation-scheduler.h"
+#include "ue-activity-manager.h"
 //#include "ns3/gtk-config-store.h"
 
 using namespace ns3;
@@ -121,6 +126,32 @@ void
                << std::endl;
    }
    
+   void
+   NotifyReportStats (std::string context,
+                      uint32_t received,
+                      uint32_t processed,
+                      double processedPerSecond)
+   {
+     std::cout << Simulator::Now ().GetSeconds () << " " << context
+               << " measurement reports received " << received
+               << ", processed " << processed
+               << " (" << processedPerSecond << " per second)"
+               << std::endl;
+   }
+
+   void
+   NotifyActivityState (uint64_t imsi,
+                        UeActivityManager::State oldState,
+                        UeActivityManager::State newState)
+   {
+     static const char *names[] = { "CONNECTED", "DRX", "INACTIVE" };
+     std::cout << Simulator::Now ().GetSeconds ()
+               << " UE with IMSI " << imsi
+               << " from " << names[oldState]
+               << " to " << names[newState]
+               << std::endl;
+   }
+
    void
    NotifyHandoverEndOkEnb (std::string context,
                            uint64_t imsi,
@@ -142,6 +173,10 @@ main (int argc, char *argv[])
   double simTime = 2.1;
   double distance = 60.0;
   double interPacketInterval = 100;
+  std::string handoverAlgorithm = "ns3::A2A4RsrqHandoverAlgorithm";
+  std::string mobilityTrace = "";
+  bool adaptiveReporting = false;
+  bool activityTimers = false;
 
   // Command line arguments
   CommandLine cmd;
@@ -149,6 +184,12 @@ main (int argc, char *argv[])
   cmd.AddValue("simTime", "Total duration of the simulation [s])", simTime);
   cmd.AddValue("distance", "Distance between eNBs [m]", distance);
   cmd.AddValue("interPacketInterval", "Inter packet interval [ms])", interPacketInterval);
+  cmd.AddValue("handoverAlgorithm", "TypeId of the handover algorithm, e.g. ns3::A3RsrpHandoverAlgorithm, "
+               "ns3::A3RsrpHandoverPolicy, ns3::A2A4RsrqHandoverPolicy, ns3::HybridHandoverPolicy, "
+               "ns3::HybridSpatialHandoverPolicy", handoverAlgorithm);
+  cmd.AddValue("mobilityTrace", "ns-2 mobility trace driving the UEs (empty for the built-in layout)", mobilityTrace);
+  cmd.AddValue("adaptiveReporting", "Adapt report processing and TTT to the UE mobility state (policy algorithms only)", adaptiveReporting);
+  cmd.AddValue("activityTimers", "Move UEs without traffic to DRX and RRC inactive", activityTimers);
   cmd.Parse(argc, argv);
 
   Ptr<LteHelper> lteHelper = CreateObject<LteHelper> ();
@@ -156,17 +197,37 @@ main (int argc, char *argv[])
   Ptr<PointToPointEpcHelper>  epcHelper = CreateObject<PointToPointEpcHelper> ();
   lteHelper->SetEpcHelper (epcHelper);
   lteHelper->SetSchedulerType ("ns3::TtaFfMacScheduler");    
- // lteHelper->SetHandoverAlgorithmType ("ns3::A3RsrpHandoverAlgorithm"); 
-  lteHelper->SetHandoverAlgorithmType ("ns3::A2A4RsrqHandoverAlgorithm");
-   lteHelper->SetHandoverAlgorithmAttribute ("ServingCellThreshold",
-                                            UintegerValue (30));
-  lteHelper->SetHandoverAlgorithmAttribute ("NeighbourCellOffset",
-                                            UintegerValue (1));
-
-    lteHelper->SetHandoverAlgorithmAttribute ("Hysteresis",
-                                              DoubleValue (3.0));
-    lteHelper->SetHandoverAlgorithmAttribute ("TimeToTrigger",
-                                              TimeValue (MilliSeconds (256)));
+  lteHelper->SetHandoverAlgorithmType (handoverAlgorithm);
+
+  // not every algorithm has every attribute, e.g. A3RsrpHandoverAlgorithm has no thresholds
+  TypeId handoverTid = TypeId::LookupByName (handoverAlgorithm);
+  struct TypeId::AttributeInformation info;
+  if (handoverTid.LookupAttributeByName ("ServingCellThreshold", &info))
+    {
+      lteHelper->SetHandoverAlgorithmAttribute ("ServingCellThreshold",
+                                                UintegerValue (30));
+    }
+  if (handoverTid.LookupAttributeByName ("NeighbourCellOffset", &info))
+    {
+      lteHelper->SetHandoverAlgorithmAttribute ("NeighbourCellOffset",
+                                                UintegerValue (1));
+    }
+  if (handoverTid.LookupAttributeByName ("Hysteresis", &info))
+    {
+      lteHelper->SetHandoverAlgorithmAttribute ("Hysteresis",
+                                                DoubleValue (3.0));
+    }
+  if (handoverTid.LookupAttributeByName ("TimeToTrigger", &info))
+    {
+      lteHelper->SetHandoverAlgorithmAttribute ("TimeToTrigger",
+                                                TimeValue (MilliSeconds (256)));
+    }
+  bool isPolicy = handoverTid.LookupAttributeByName ("AdaptiveReporting", &info);
+  if (isPolicy)
+    {
+      lteHelper->SetHandoverAlgorithmAttribute ("AdaptiveReporting",
+                                                BooleanValue (adaptiveReporting));
+    }
 
      
         
@@ -231,6 +292,8 @@ main (int argc, char *argv[])
                                  "Theta",StringValue(" ns3::UniformRandomVariable[Min=0.0|Max=6.2830] "),
                                  "Rho", StringValue("ns3::UniformRandomVariable[Min=0|Max=12]"));*/
 
+if (mobilityTrace.empty ())
+  {
  mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
  //mobility.SetPositionAllocator(positionAlloc);
  mobility.Install(ueNodes.Get(1));
@@ -242,6 +305,13 @@ main (int argc, char *argv[])
   mobility.Install (ueNodes.Get(4));
   ueNodes.Get (4)->GetObject<MobilityModel> ()->SetPosition (Vector (12, 0, 0));
   ueNodes.Get (4)->GetObject<ConstantVelocityMobilityModel> ()->SetVelocity (Vector (0, 15, 0));
+  }
+else
+  {
+    // trace node i drives the i-th UE
+    Ns2MobilityHelper ns2 (mobilityTrace);
+    ns2.Install (ueNodes.Begin (), ueNodes.End ());
+  }
 
  //MobilityHelper mobility1;
  mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
@@ -252,6 +322,41 @@ main (int argc, char *argv[])
   NetDeviceContainer enbLteDevs = lteHelper->InstallEnbDevice (enbNodes);
   NetDeviceContainer ueLteDevs = lteHelper->InstallUeDevice (ueNodes);
 
+  // (cellId, RNTI) to IMSI, shared by the helpers below
+  Ptr<UeContextTracker> ueContexts = CreateObject<UeContextTracker> ();
+  for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+    {
+      ueContexts->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+    }
+
+  // candidate cells per UE, used by the *SpatialHandoverPolicy algorithms
+  Ptr<EnbSpatialIndex> spatialIndex = CreateObject<EnbSpatialIndex> ();
+  spatialIndex->SetUeContextTracker (ueContexts);
+  for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+    {
+      spatialIndex->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+    }
+  for (uint32_t u = 0; u < ueLteDevs.GetN (); ++u)
+    {
+      spatialIndex->AddUe (ueLteDevs.Get (u)->GetObject<LteUeNetDevice> ());
+    }
+
+  // handover count and RSRP slope per UE, used by AdaptiveReporting
+  Ptr<UeMobilityStateTracker> mobilityStateTracker = CreateObject<UeMobilityStateTracker> ();
+  mobilityStateTracker->SetUeContextTracker (ueContexts);
+  for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+    {
+      mobilityStateTracker->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+    }
+
+  // X2 handover preparations per eNB pair, throttled during handover storms
+  Ptr<HandoverPreparationScheduler> preparationScheduler = CreateObject<HandoverPreparationScheduler> ();
+  preparationScheduler->SetUeContextTracker (ueContexts);
+  for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+    {
+      preparationScheduler->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+    }
+
   // Install the IP stack on the UEs
   internet.Install (ueNodes);
   Ipv4InterfaceContainer ueIpIface;
@@ -272,6 +377,24 @@ main (int argc, char *argv[])
     lteHelper->Attach (ueLteDevs.Get(0), enbLteDevs.Get(1));
     lteHelper->Attach (ueLteDevs.Get(2), enbLteDevs.Get(1));
 
+  // traffic inactivity timers, DRX and RRC inactive
+  Ptr<UeActivityManager> activityManager;
+  if (activityTimers)
+    {
+      activityManager = CreateObject<UeActivityManager> ();
+      activityManager->SetUeContextTracker (ueContexts);
+      for (uint32_t i = 0; i < enbLteDevs.GetN (); ++i)
+        {
+          activityManager->AddEnb (enbLteDevs.Get (i)->GetObject<LteEnbNetDevice> ());
+        }
+      for (uint32_t u = 0; u < ueLteDevs.GetN (); ++u)
+        {
+          activityManager->AddUe (ueLteDevs.Get (u)->GetObject<LteUeNetDevice> ());
+        }
+      activityManager->TraceConnectWithoutContext ("StateTransition",
+                                                   MakeCallback (&NotifyActivityState));
+    }
+
 
   // Install and start applications on UEs and remote host
   uint16_t dlPort = 1234;
@@ -341,6 +464,11 @@ main (int argc, char *argv[])
                       MakeCallback (&NotifyHandoverEndOkEnb));
      Config::Connect ("/NodeList/*/DeviceList/*/LteUeRrc/HandoverEndOk",
                       MakeCallback (&NotifyHandoverEndOkUe));
+     if (isPolicy)
+       {
+         Config::Connect ("/NodeList/*/DeviceList/*/LteHandoverAlgorithm/ReportStats",
+                          MakeCallback (&NotifyReportStats));
+       }
 
 
 
@@ -382,6 +510,21 @@ main (int argc, char *argv[])
   //flowmon->SerializeToXmlFile ("flowepc.xml", bool enableHistograms, bool enableProbes);
   monitor->SerializeToXmlFile ("flowmonitorstats.xml", true, true);
 
+  if (isPolicy)
+    {
+      HandoverPreparationScheduler::Stats hoStats = preparationScheduler->GetStats ();
+      std::cout << "Handover preparations: submitted " << hoStats.submitted
+                << ", dispatched " << hoStats.dispatched
+                << ", rejected " << hoStats.rejected
+                << ", acknowledged " << hoStats.acknowledged
+                << ", timed out " << hoStats.timedOut << "\n";
+      if (hoStats.dispatched > 0)
+        {
+          std::cout << "  mean queue delay " << hoStats.totalQueueDelay.GetSeconds () * 1000 / hoStats.dispatched
+                    << " ms, max " << hoStats.maxQueueDelay.GetSeconds () * 1000 << " ms\n";
+        }
+    }
+
  
   /*GtkConfigStore config;
   config.ConfigureAttributes();*/
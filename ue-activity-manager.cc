@@ -0,0 +1,275 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ue-activity-manager.h"
+#include "policy-handover-algorithm.h"
+#include "ue-context-tracker.h"
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/trace-source-accessor.h>
+#include <ns3/ipv4-l3-protocol.h>
+#include <ns3/lte-enb-net-device.h>
+#include <ns3/lte-ue-net-device.h>
+#include <ns3/lte-ue-phy.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("UeActivityManager");
+
+NS_OBJECT_ENSURE_REGISTERED (UeActivityManager);
+
+
+UeActivityManager::UeInfo::UeInfo ()
+  : state (CONNECTED)
+{
+}
+
+
+UeActivityManager::UeActivityManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+UeActivityManager::~UeActivityManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+UeActivityManager::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::UeActivityManager")
+    .SetParent<Object> ()
+    .SetGroupName("Lte")
+    .AddConstructor<UeActivityManager> ()
+    .AddAttribute ("DrxInactivityTimer",
+                   "Time without traffic after which a UE enters "
+                   "connected mode DRX",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&UeActivityManager::m_drxInactivityTimer),
+                   MakeTimeChecker ())
+    .AddAttribute ("InactivityTimer",
+                   "Time without traffic after which a UE becomes RRC "
+                   "inactive",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&UeActivityManager::m_inactivityTimer),
+                   MakeTimeChecker ())
+    .AddAttribute ("DrxMeasurementPeriod",
+                   "UE PHY measurement period in connected mode DRX",
+                   TimeValue (MilliSeconds (640)),
+                   MakeTimeAccessor (&UeActivityManager::m_drxMeasurementPeriod),
+                   MakeTimeChecker ())
+    .AddAttribute ("InactiveMeasurementPeriod",
+                   "UE PHY measurement period of RRC inactive UEs",
+                   TimeValue (MilliSeconds (1280)),
+                   MakeTimeAccessor (&UeActivityManager::m_inactiveMeasurementPeriod),
+                   MakeTimeChecker ())
+    .AddTraceSource ("StateTransition",
+                     "A UE changed activity state",
+                     MakeTraceSourceAccessor (&UeActivityManager::m_stateTransitionTrace),
+                     "ns3::UeActivityManager::StateTransitionTracedCallback")
+  ;
+  return tid;
+}
+
+
+void
+UeActivityManager::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<uint64_t, UeInfo>::iterator it = m_ues.begin (); it != m_ues.end (); ++it)
+    {
+      it->second.timer.Cancel ();
+    }
+  m_ues.clear ();
+  m_imsiByIpv4.clear ();
+  m_ueContexts = 0;
+}
+
+
+void
+UeActivityManager::SetUeContextTracker (Ptr<UeContextTracker> ueContexts)
+{
+  NS_LOG_FUNCTION (this << ueContexts);
+  m_ueContexts = ueContexts;
+}
+
+
+void
+UeActivityManager::AddEnb (Ptr<LteEnbNetDevice> enbDevice)
+{
+  NS_LOG_FUNCTION (this << enbDevice);
+
+  Ptr<PolicyHandoverAlgorithmBase> policy = PolicyHandoverAlgorithmBase::GetPolicy (enbDevice);
+  if (policy != 0)
+    {
+      policy->BindEnb (enbDevice);
+      policy->SetActivityManager (this);
+    }
+}
+
+
+void
+UeActivityManager::AddUe (Ptr<LteUeNetDevice> ueDevice)
+{
+  NS_LOG_FUNCTION (this << ueDevice);
+
+  Ptr<Ipv4L3Protocol> ipv4 = ueDevice->GetNode ()->GetObject<Ipv4L3Protocol> ();
+  NS_ASSERT_MSG (ipv4 != 0, "the internet stack must be installed on the UE first");
+  ipv4->TraceConnectWithoutContext ("Tx", MakeCallback (&UeActivityManager::NotifyPacket, this));
+  ipv4->TraceConnectWithoutContext ("Rx", MakeCallback (&UeActivityManager::NotifyPacket, this));
+
+  uint64_t imsi = ueDevice->GetImsi ();
+  m_imsiByIpv4[ipv4] = imsi;
+
+  UeInfo &ueInfo = m_ues[imsi];
+  ueInfo.device = ueDevice;
+  ueInfo.lastActivity = Simulator::Now ();
+  // restored on return to CONNECTED, so that the user's setting is kept
+  TimeValue connectedPeriod;
+  ueDevice->GetPhy ()->GetAttribute ("UeMeasurementsFilterPeriod", connectedPeriod);
+  ueInfo.connectedMeasurementPeriod = connectedPeriod.Get ();
+  ueInfo.timer = Simulator::Schedule (m_drxInactivityTimer,
+                                      &UeActivityManager::CheckInactivity, this, imsi);
+}
+
+
+UeActivityManager::State
+UeActivityManager::GetState (uint16_t cellId, uint16_t rnti) const
+{
+  uint64_t imsi = m_ueContexts == 0 ? 0 : m_ueContexts->GetImsi (cellId, rnti);
+  if (imsi == 0)
+    {
+      return CONNECTED;
+    }
+  return GetStateByImsi (imsi);
+}
+
+
+UeActivityManager::State
+UeActivityManager::GetStateByImsi (uint64_t imsi) const
+{
+  std::map<uint64_t, UeInfo>::const_iterator it = m_ues.find (imsi);
+  if (it == m_ues.end ())
+    {
+      return CONNECTED;
+    }
+  return it->second.state;
+}
+
+
+uint32_t
+UeActivityManager::GetNUes (State state) const
+{
+  uint32_t n = 0;
+  for (std::map<uint64_t, UeInfo>::const_iterator it = m_ues.begin (); it != m_ues.end (); ++it)
+    {
+      if (it->second.state == state)
+        {
+          ++n;
+        }
+    }
+  return n;
+}
+
+
+void
+UeActivityManager::NotifyPacket (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+  std::map<Ptr<Ipv4>, uint64_t>::const_iterator it = m_imsiByIpv4.find (ipv4);
+  if (it == m_imsiByIpv4.end ())
+    {
+      return;
+    }
+  uint64_t imsi = it->second;
+  UeInfo &ueInfo = m_ues[imsi];
+  ueInfo.lastActivity = Simulator::Now ();
+
+  if (ueInfo.state != CONNECTED)
+    {
+      SetState (imsi, ueInfo, CONNECTED);
+      // the pending check is for the inactivity timer, far too late
+      ueInfo.timer.Cancel ();
+    }
+  if (!ueInfo.timer.IsRunning ())
+    {
+      ueInfo.timer = Simulator::Schedule (m_drxInactivityTimer,
+                                          &UeActivityManager::CheckInactivity, this, imsi);
+    }
+}
+
+
+void
+UeActivityManager::CheckInactivity (uint64_t imsi)
+{
+  NS_LOG_FUNCTION (this << imsi);
+
+  UeInfo &ueInfo = m_ues[imsi];
+  Time idle = Simulator::Now () - ueInfo.lastActivity;
+
+  // traffic since the check was scheduled postpones it, see NotifyPacket
+  if (ueInfo.state == CONNECTED)
+    {
+      if (idle < m_drxInactivityTimer)
+        {
+          ueInfo.timer = Simulator::Schedule (m_drxInactivityTimer - idle,
+                                              &UeActivityManager::CheckInactivity, this, imsi);
+          return;
+        }
+      SetState (imsi, ueInfo, DRX);
+    }
+  if (ueInfo.state == DRX)
+    {
+      if (idle < m_inactivityTimer)
+        {
+          ueInfo.timer = Simulator::Schedule (m_inactivityTimer - idle,
+                                              &UeActivityManager::CheckInactivity, this, imsi);
+          return;
+        }
+      SetState (imsi, ueInfo, INACTIVE);
+    }
+}
+
+
+void
+UeActivityManager::SetState (uint64_t imsi, UeInfo &ueInfo, State state)
+{
+  NS_LOG_FUNCTION (this << imsi << ueInfo.state << state);
+
+  State oldState = ueInfo.state;
+  ueInfo.state = state;
+
+  Time period = ueInfo.connectedMeasurementPeriod;
+  if (state == DRX)
+    {
+      period = m_drxMeasurementPeriod;
+    }
+  else if (state == INACTIVE)
+    {
+      period = m_inactiveMeasurementPeriod;
+    }
+  // only sampling and event evaluation slow down, periodic reports of
+  // triggered events keep their reportInterval
+  ueInfo.device->GetPhy ()->SetAttribute ("UeMeasurementsFilterPeriod", TimeValue (period));
+
+  NS_LOG_INFO ("UE with IMSI " << imsi << " from state " << oldState << " to " << state);
+  m_stateTransitionTrace (imsi, oldState, state);
+}
+
+
+} // namespace ns3
@@ -0,0 +1,165 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UE_ACTIVITY_MANAGER_H
+#define UE_ACTIVITY_MANAGER_H
+
+#include <ns3/object.h>
+#include <ns3/ptr.h>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/traced-callback.h>
+#include <map>
+
+namespace ns3 {
+
+class Packet;
+class Ipv4;
+class LteEnbNetDevice;
+class LteUeNetDevice;
+class UeContextTracker;
+
+
+/**
+ * \brief Traffic inactivity timers moving UEs to DRX and RRC inactive.
+ *
+ * Every IP packet sent or received by a UE restarts its inactivity
+ * timers. A UE without traffic for DrxInactivityTimer enters connected
+ * mode DRX, and after InactivityTimer it becomes RRC inactive; the next
+ * packet brings it back to CONNECTED. The timers are evaluated lazily, so
+ * a busy UE costs one event per DrxInactivityTimer rather than one per
+ * packet.
+ *
+ * In DRX and RRC inactive the layer 1 measurement period of the UE PHY
+ * (LteUePhy::UeMeasurementsFilterPeriod) is set to the period of the
+ * state, and back in CONNECTED to the value it had when the UE was added
+ * with AddUe(). DRX and inactive UEs then deliver layer 1 samples to
+ * their RRC less often, which saves the PHY measurement events and the
+ * layer 3 filtering and event entry evaluation done on each sample. It
+ * does not reduce the measurement reports of events already triggered:
+ * these are sent every reportInterval of the report configuration, which
+ * the RRC keeps unchanged. Handover algorithms derived from
+ * PolicyHandoverAlgorithmBase of an eNodeB added with AddEnb() drop the
+ * A4 reports of inactive UEs in normal mobility state on arrival; A2 and
+ * A3/A5 reports are still handled, so that a moving inactive UE, which
+ * stays RRC connected to its cell, still hands over.
+ */
+class UeActivityManager : public Object
+{
+public:
+  /// Activity state of a UE.
+  enum State
+  {
+    CONNECTED = 0,
+    DRX,
+    INACTIVE
+  };
+
+  UeActivityManager ();
+  virtual ~UeActivityManager ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  /**
+   * \param ueContexts the tracker mapping (cell ID, RNTI) to IMSI
+   */
+  void SetUeContextTracker (Ptr<UeContextTracker> ueContexts);
+
+  /**
+   * If the handover algorithm of the eNodeB is a
+   * PolicyHandoverAlgorithmBase, make it pause the A4 reports of inactive
+   * UEs.
+   * \param enbDevice
+   */
+  void AddEnb (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * Start the inactivity timers of a UE. The internet stack must already
+   * be installed on its node.
+   * \param ueDevice
+   */
+  void AddUe (Ptr<LteUeNetDevice> ueDevice);
+
+  /**
+   * \param cellId
+   * \param rnti
+   * \return the state of the UE, CONNECTED if it is unknown
+   */
+  State GetState (uint16_t cellId, uint16_t rnti) const;
+
+  /**
+   * \param imsi
+   * \return the state of the UE, CONNECTED if it is unknown
+   */
+  State GetStateByImsi (uint64_t imsi) const;
+
+  /**
+   * \param state
+   * \return the number of UEs currently in the state
+   */
+  uint32_t GetNUes (State state) const;
+
+  /**
+   * TracedCallback signature for state transitions.
+   *
+   * \param [in] imsi
+   * \param [in] oldState
+   * \param [in] newState
+   */
+  typedef void (* StateTransitionTracedCallback)
+    (uint64_t imsi, State oldState, State newState);
+
+protected:
+  // inherited from Object
+  virtual void DoDispose ();
+
+private:
+  /// Per-UE timers.
+  struct UeInfo
+  {
+    UeInfo ();
+
+    Ptr<LteUeNetDevice> device;
+    State state;
+    Time lastActivity;
+    /// UE PHY measurement period when the UE was added
+    Time connectedMeasurementPeriod;
+    EventId timer;
+  };
+
+  void NotifyPacket (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+  void CheckInactivity (uint64_t imsi);
+  void SetState (uint64_t imsi, UeInfo &ueInfo, State state);
+
+  Time m_drxInactivityTimer;
+  Time m_inactivityTimer;
+  Time m_drxMeasurementPeriod;
+  Time m_inactiveMeasurementPeriod;
+
+  std::map<uint64_t, UeInfo> m_ues;
+  /// IMSI of the UEs, indexed by the IPv4 stack of their node
+  std::map<Ptr<Ipv4>, uint64_t> m_imsiByIpv4;
+  Ptr<UeContextTracker> m_ueContexts;
+
+  TracedCallback<uint64_t, State, State> m_stateTransitionTrace;
+
+}; // end of class UeActivityManager
+
+
+} // namespace ns3
+
+#endif /* UE_ACTIVITY_MANAGER_H */
@@ -0,0 +1,202 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ue-context-tracker.h"
+#include "policy-handover-algorithm.h"
+#include <ns3/log.h>
+#include <ns3/trace-source-accessor.h>
+#include <ns3/lte-enb-net-device.h>
+#include <ns3/lte-enb-rrc.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("UeContextTracker");
+
+NS_OBJECT_ENSURE_REGISTERED (UeContextTracker);
+
+
+UeContextTracker::UeContextTracker ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+UeContextTracker::~UeContextTracker ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+UeContextTracker::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::UeContextTracker")
+    .SetParent<Object> ()
+    .SetGroupName("Lte")
+    .AddConstructor<UeContextTracker> ()
+    .AddTraceSource ("HandoverStart",
+                     "A UE started leaving its cell, fired before its "
+                     "source context is removed",
+                     MakeTraceSourceAccessor (&UeContextTracker::m_handoverStartTrace),
+                     "ns3::UeContextTracker::HandoverStartTracedCallback")
+    .AddTraceSource ("HandoverEndOk",
+                     "A UE completed a handover into its new cell",
+                     MakeTraceSourceAccessor (&UeContextTracker::m_handoverEndOkTrace),
+                     "ns3::UeContextTracker::UeContextTracedCallback")
+    .AddTraceSource ("ContextRemoved",
+                     "A UE context is no longer valid",
+                     MakeTraceSourceAccessor (&UeContextTracker::m_contextRemovedTrace),
+                     "ns3::UeContextTracker::UeContextTracedCallback")
+  ;
+  return tid;
+}
+
+
+void
+UeContextTracker::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_enbs.clear ();
+  m_policies.clear ();
+  m_imsiByRnti.clear ();
+}
+
+
+void
+UeContextTracker::AddEnb (Ptr<LteEnbNetDevice> enbDevice)
+{
+  NS_LOG_FUNCTION (this << enbDevice);
+
+  uint16_t cellId = enbDevice->GetCellId ();
+  if (m_enbs.find (cellId) != m_enbs.end ())
+    {
+      return;
+    }
+  m_enbs[cellId] = enbDevice;
+
+  Ptr<PolicyHandoverAlgorithmBase> policy = PolicyHandoverAlgorithmBase::GetPolicy (enbDevice);
+  if (policy != 0)
+    {
+      m_policies[cellId] = policy;
+    }
+
+  Ptr<LteEnbRrc> rrc = enbDevice->GetRrc ();
+  rrc->TraceConnectWithoutContext ("NewUeContext",
+                                   MakeCallback (&UeContextTracker::NotifyNewUeContext, this));
+  rrc->TraceConnectWithoutContext ("ConnectionEstablished",
+                                   MakeCallback (&UeContextTracker::NotifyConnectionEstablished, this));
+  rrc->TraceConnectWithoutContext ("HandoverStart",
+                                   MakeCallback (&UeContextTracker::NotifyHandoverStart, this));
+  rrc->TraceConnectWithoutContext ("HandoverEndOk",
+                                   MakeCallback (&UeContextTracker::NotifyHandoverEndOk, this));
+  // only recent versions of the LTE module release contexts
+  if (!rrc->TraceConnectWithoutContext ("ConnectionRelease",
+                                        MakeCallback (&UeContextTracker::NotifyConnectionRelease, this)))
+    {
+      NS_LOG_LOGIC ("no ConnectionRelease trace in the RRC of cellId " << cellId);
+    }
+}
+
+
+uint64_t
+UeContextTracker::GetImsi (uint16_t cellId, uint16_t rnti) const
+{
+  std::map<std::pair<uint16_t, uint16_t>, uint64_t>::const_iterator it;
+  it = m_imsiByRnti.find (std::make_pair (cellId, rnti));
+  if (it == m_imsiByRnti.end ())
+    {
+      return 0;
+    }
+  return it->second;
+}
+
+
+void
+UeContextTracker::RemoveContext (uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << cellId << rnti);
+
+  ResetPolicyState (cellId, rnti);
+
+  std::map<std::pair<uint16_t, uint16_t>, uint64_t>::iterator it;
+  it = m_imsiByRnti.find (std::make_pair (cellId, rnti));
+  if (it == m_imsiByRnti.end ())
+    {
+      return;
+    }
+  uint64_t imsi = it->second;
+  m_imsiByRnti.erase (it);
+  m_contextRemovedTrace (imsi, cellId, rnti);
+}
+
+
+void
+UeContextTracker::ResetPolicyState (uint16_t cellId, uint16_t rnti)
+{
+  std::map<uint16_t, Ptr<PolicyHandoverAlgorithmBase> >::const_iterator it;
+  it = m_policies.find (cellId);
+  if (it != m_policies.end ())
+    {
+      it->second->NotifyUeContextRemoved (rnti);
+    }
+}
+
+
+void
+UeContextTracker::NotifyNewUeContext (uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << cellId << rnti);
+  // a context still mapped here was released without a trace, and the
+  // policy may have kept state from reports received after the release
+  RemoveContext (cellId, rnti);
+}
+
+
+void
+UeContextTracker::NotifyConnectionEstablished (uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti);
+  m_imsiByRnti[std::make_pair (cellId, rnti)] = imsi;
+}
+
+
+void
+UeContextTracker::NotifyHandoverStart (uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti << targetCellId);
+  m_handoverStartTrace (imsi, cellId, rnti, targetCellId);
+  RemoveContext (cellId, rnti);
+}
+
+
+void
+UeContextTracker::NotifyHandoverEndOk (uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti);
+  m_imsiByRnti[std::make_pair (cellId, rnti)] = imsi;
+  m_handoverEndOkTrace (imsi, cellId, rnti);
+}
+
+
+void
+UeContextTracker::NotifyConnectionRelease (uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti);
+  RemoveContext (cellId, rnti);
+}
+
+
+} // namespace ns3
@@ -0,0 +1,122 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UE_CONTEXT_TRACKER_H
+#define UE_CONTEXT_TRACKER_H
+
+#include <ns3/object.h>
+#include <ns3/ptr.h>
+#include <ns3/traced-callback.h>
+#include <map>
+
+namespace ns3 {
+
+class LteEnbNetDevice;
+class PolicyHandoverAlgorithmBase;
+
+
+/**
+ * \brief Maps the (cell ID, RNTI) of the UE contexts of the eNodeBs to
+ *        the IMSI of the UEs.
+ *
+ * Handover algorithms see UEs by (cell ID, RNTI), while per-UE state that
+ * follows the UE from cell to cell is keyed by IMSI. This tracker follows
+ * the RRC traces of the eNodeBs added with AddEnb() and is shared by all
+ * the helpers needing that mapping.
+ *
+ * A context is removed when its UE starts leaving the cell (HandoverStart
+ * of the source eNodeB), when the RRC releases it (ConnectionRelease,
+ * where the LTE module provides it), and when the RRC creates a new
+ * context with the same RNTI, so that a reused RNTI never maps to the
+ * IMSI of a previous UE. The ContextRemoved trace reports each removal.
+ * In all these cases the handover algorithm of the eNodeB, if it is a
+ * PolicyHandoverAlgorithmBase, forgets the per-UE state of the RNTI.
+ */
+class UeContextTracker : public Object
+{
+public:
+  UeContextTracker ();
+  virtual ~UeContextTracker ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  /**
+   * Follow the RRC traces of an eNodeB. Adding an eNodeB again has no
+   * effect.
+   * \param enbDevice
+   */
+  void AddEnb (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * \param cellId
+   * \param rnti
+   * \return the IMSI of the UE, or zero if the context is unknown
+   */
+  uint64_t GetImsi (uint16_t cellId, uint16_t rnti) const;
+
+  /**
+   * TracedCallback signature for UE context events.
+   *
+   * \param [in] imsi
+   * \param [in] cellId
+   * \param [in] rnti
+   */
+  typedef void (* UeContextTracedCallback)
+    (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+
+  /**
+   * TracedCallback signature for the start of a handover at the source.
+   *
+   * \param [in] imsi
+   * \param [in] cellId source cell ID
+   * \param [in] rnti RNTI in the source cell
+   * \param [in] targetCellId
+   */
+  typedef void (* HandoverStartTracedCallback)
+    (uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId);
+
+protected:
+  // inherited from Object
+  virtual void DoDispose ();
+
+private:
+  void RemoveContext (uint16_t cellId, uint16_t rnti);
+  void ResetPolicyState (uint16_t cellId, uint16_t rnti);
+
+  void NotifyNewUeContext (uint16_t cellId, uint16_t rnti);
+  void NotifyConnectionEstablished (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+  void NotifyHandoverStart (uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId);
+  void NotifyHandoverEndOk (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+  void NotifyConnectionRelease (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+
+  /// cell IDs of the eNodeBs already followed
+  std::map<uint16_t, Ptr<LteEnbNetDevice> > m_enbs;
+  /// handover algorithms of the eNodeBs which are policies
+  std::map<uint16_t, Ptr<PolicyHandoverAlgorithmBase> > m_policies;
+  /// IMSI of the UE contexts, indexed by (cell ID, RNTI)
+  std::map<std::pair<uint16_t, uint16_t>, uint64_t> m_imsiByRnti;
+
+  TracedCallback<uint64_t, uint16_t, uint16_t, uint16_t> m_handoverStartTrace;
+  TracedCallback<uint64_t, uint16_t, uint16_t> m_handoverEndOkTrace;
+  TracedCallback<uint64_t, uint16_t, uint16_t> m_contextRemovedTrace;
+
+}; // end of class UeContextTracker
+
+
+} // namespace ns3
+
+#endif /* UE_CONTEXT_TRACKER_H */
@@ -0,0 +1,207 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ue-mobility-state-tracker.h"
+#include "policy-handover-algorithm.h"
+#include "ue-context-tracker.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/lte-enb-net-device.h>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("UeMobilityStateTracker");
+
+NS_OBJECT_ENSURE_REGISTERED (UeMobilityStateTracker);
+
+
+UeMobilityStateTracker::UeInfo::UeInfo ()
+  : lastRsrp (0),
+    haveRsrp (false),
+    rsrpSlope (0.0)
+{
+}
+
+
+UeMobilityStateTracker::UeMobilityStateTracker ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+UeMobilityStateTracker::~UeMobilityStateTracker ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+
+TypeId
+UeMobilityStateTracker::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::UeMobilityStateTracker")
+    .SetParent<Object> ()
+    .SetGroupName("Lte")
+    .AddConstructor<UeMobilityStateTracker> ()
+    .AddAttribute ("EvaluationWindow",
+                   "Window over which handovers are counted "
+                   "(t-Evaluation of Section 6.3.4 of 3GPP TS 36.331)",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&UeMobilityStateTracker::m_evaluationWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("HandoversMedium",
+                   "Number of handovers within EvaluationWindow entering "
+                   "the medium mobility state (n-CellChangeMedium)",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&UeMobilityStateTracker::m_handoversMedium),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("HandoversHigh",
+                   "Number of handovers within EvaluationWindow entering "
+                   "the high mobility state (n-CellChangeHigh)",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&UeMobilityStateTracker::m_handoversHigh),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("RsrpSlopeMedium",
+                   "Serving cell RSRP slope entering the medium mobility "
+                   "state [dB/s]",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&UeMobilityStateTracker::m_rsrpSlopeMedium),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("RsrpSlopeHigh",
+                   "Serving cell RSRP slope entering the high mobility "
+                   "state [dB/s]",
+                   DoubleValue (6.0),
+                   MakeDoubleAccessor (&UeMobilityStateTracker::m_rsrpSlopeHigh),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("RsrpSlopeSmoothing",
+                   "Weight of the newest sample in the exponential average "
+                   "of the RSRP slope",
+                   DoubleValue (0.3),
+                   MakeDoubleAccessor (&UeMobilityStateTracker::m_rsrpSlopeSmoothing),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+  ;
+  return tid;
+}
+
+
+void
+UeMobilityStateTracker::SetUeContextTracker (Ptr<UeContextTracker> ueContexts)
+{
+  NS_LOG_FUNCTION (this << ueContexts);
+  m_ueContexts = ueContexts;
+  m_ueContexts->TraceConnectWithoutContext ("HandoverEndOk",
+                                            MakeCallback (&UeMobilityStateTracker::NotifyHandoverEndOk, this));
+}
+
+
+void
+UeMobilityStateTracker::AddEnb (Ptr<LteEnbNetDevice> enbDevice)
+{
+  NS_LOG_FUNCTION (this << enbDevice);
+
+  Ptr<PolicyHandoverAlgorithmBase> policy = PolicyHandoverAlgorithmBase::GetPolicy (enbDevice);
+  if (policy != 0)
+    {
+      policy->BindEnb (enbDevice);
+      policy->SetMobilityStateTracker (this);
+    }
+}
+
+
+void
+UeMobilityStateTracker::NotifyServingRsrp (uint16_t cellId, uint16_t rnti, uint8_t rsrp)
+{
+  NS_LOG_FUNCTION (this << cellId << rnti << (uint16_t) rsrp);
+
+  uint64_t imsi = m_ueContexts == 0 ? 0 : m_ueContexts->GetImsi (cellId, rnti);
+  if (imsi == 0)
+    {
+      return;
+    }
+
+  UeInfo &ueInfo = m_ues[imsi];
+  Time now = Simulator::Now ();
+  if (ueInfo.haveRsrp && now > ueInfo.lastRsrpTime)
+    {
+      // quantized RSRP has a resolution of 1 dB
+      double slope = std::fabs ((double) rsrp - (double) ueInfo.lastRsrp)
+        / (now - ueInfo.lastRsrpTime).GetSeconds ();
+      ueInfo.rsrpSlope = m_rsrpSlopeSmoothing * slope
+        + (1.0 - m_rsrpSlopeSmoothing) * ueInfo.rsrpSlope;
+    }
+  ueInfo.lastRsrp = rsrp;
+  ueInfo.lastRsrpTime = now;
+  ueInfo.haveRsrp = true;
+}
+
+
+UeMobilityStateTracker::State
+UeMobilityStateTracker::GetState (uint16_t cellId, uint16_t rnti)
+{
+  uint64_t imsi = m_ueContexts == 0 ? 0 : m_ueContexts->GetImsi (cellId, rnti);
+  if (imsi == 0)
+    {
+      return NORMAL;
+    }
+  return GetStateByImsi (imsi);
+}
+
+
+UeMobilityStateTracker::State
+UeMobilityStateTracker::GetStateByImsi (uint64_t imsi)
+{
+  std::map<uint64_t, UeInfo>::iterator it = m_ues.find (imsi);
+  if (it == m_ues.end ())
+    {
+      return NORMAL;
+    }
+
+  UeInfo &ueInfo = it->second;
+  Time now = Simulator::Now ();
+  while (!ueInfo.handoverTimes.empty ()
+         && ueInfo.handoverTimes.front () + m_evaluationWindow < now)
+    {
+      ueInfo.handoverTimes.pop_front ();
+    }
+
+  uint32_t nHandovers = ueInfo.handoverTimes.size ();
+  if (nHandovers >= m_handoversHigh || ueInfo.rsrpSlope >= m_rsrpSlopeHigh)
+    {
+      return HIGH;
+    }
+  if (nHandovers >= m_handoversMedium || ueInfo.rsrpSlope >= m_rsrpSlopeMedium)
+    {
+      return MEDIUM;
+    }
+  return NORMAL;
+}
+
+
+void
+UeMobilityStateTracker::NotifyHandoverEndOk (uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << imsi << cellId << rnti);
+
+  UeInfo &ueInfo = m_ues[imsi];
+  ueInfo.handoverTimes.push_back (Simulator::Now ());
+  // the serving cell changed, so the RSRP history is no longer comparable
+  ueInfo.haveRsrp = false;
+}
+
+
+} // namespace ns3
@@ -0,0 +1,128 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UE_MOBILITY_STATE_TRACKER_H
+#define UE_MOBILITY_STATE_TRACKER_H
+
+#include <ns3/object.h>
+#include <ns3/ptr.h>
+#include <ns3/nstime.h>
+#include <deque>
+#include <map>
+
+namespace ns3 {
+
+class LteEnbNetDevice;
+class UeContextTracker;
+
+
+/**
+ * \brief Estimates the mobility state of each UE across all eNodeBs.
+ *
+ * The state follows the idea of the speed dependent scaling of Section
+ * 5.5.6.2 of 3GPP TS 36.331: a UE is in medium or high mobility state
+ * when it performed at least HandoversMedium or HandoversHigh handovers
+ * during the last EvaluationWindow. The handover count is complemented by
+ * the smoothed slope of the serving cell RSRP reported to the handover
+ * algorithms, so that a fast UE is detected before its first handover.
+ *
+ * The handover history follows the UE from cell to cell, which is why the
+ * tracker is shared by all eNodeBs and keyed by IMSI; the UeContextTracker
+ * given to SetUeContextTracker() maps (cell ID, RNTI) to IMSI and reports
+ * the handovers.
+ */
+class UeMobilityStateTracker : public Object
+{
+public:
+  /// Mobility state of a UE.
+  enum State
+  {
+    NORMAL = 0,
+    MEDIUM,
+    HIGH
+  };
+
+  UeMobilityStateTracker ();
+  virtual ~UeMobilityStateTracker ();
+
+  // inherited from Object
+  static TypeId GetTypeId ();
+
+  /**
+   * Map UEs to IMSI and follow their handovers with a UE context tracker.
+   * \param ueContexts
+   */
+  void SetUeContextTracker (Ptr<UeContextTracker> ueContexts);
+
+  /**
+   * If the handover algorithm of the eNodeB is a
+   * PolicyHandoverAlgorithmBase, make it use this tracker.
+   * \param enbDevice
+   */
+  void AddEnb (Ptr<LteEnbNetDevice> enbDevice);
+
+  /**
+   * Feed the serving cell RSRP of a measurement report.
+   * \param cellId
+   * \param rnti
+   * \param rsrp quantized RSRP as per Section 9.1.4 of 3GPP TS 36.133
+   */
+  void NotifyServingRsrp (uint16_t cellId, uint16_t rnti, uint8_t rsrp);
+
+  /**
+   * \param cellId
+   * \param rnti
+   * \return the mobility state of the UE, NORMAL if it is unknown
+   */
+  State GetState (uint16_t cellId, uint16_t rnti);
+
+  /**
+   * \param imsi
+   * \return the mobility state of the UE, NORMAL if it is unknown
+   */
+  State GetStateByImsi (uint64_t imsi);
+
+private:
+  /// Per-UE history.
+  struct UeInfo
+  {
+    UeInfo ();
+
+    std::deque<Time> handoverTimes;
+    Time lastRsrpTime;
+    uint8_t lastRsrp;
+    bool haveRsrp;
+    double rsrpSlope; ///< smoothed |dRSRP/dt| in dB/s
+  };
+
+  void NotifyHandoverEndOk (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+
+  Time m_evaluationWindow;
+  uint32_t m_handoversMedium;
+  uint32_t m_handoversHigh;
+  double m_rsrpSlopeMedium;
+  double m_rsrpSlopeHigh;
+  double m_rsrpSlopeSmoothing;
+
+  std::map<uint64_t, UeInfo> m_ues;
+  Ptr<UeContextTracker> m_ueContexts;
+
+}; // end of class UeMobilityStateTracker
+
+
+} // namespace ns3
+
+#endif /* UE_MOBILITY_STATE_TRACKER_H */